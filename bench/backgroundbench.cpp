@@ -0,0 +1,148 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QDialog>
+#include <QGridLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPaintEvent>
+#include <QPixmap>
+#include <QPushButton>
+#include <QSpinBox>
+
+#include "backgroundrenderer.h"
+#include "benchmark.h"
+
+namespace
+{
+    //! Frames painted per measurement.
+    const int FRAMES = 200;
+
+    //! Dialog painting its background with a BackgroundRenderer.
+    class CachedDialog : public QDialog
+    {
+    public:
+
+        CachedDialog()
+        : m_background(":/back.png")
+        {
+            setAttribute(Qt::WA_OpaquePaintEvent);
+        }
+
+        int renderCount() const
+        {
+            return m_background.renderCount();
+        }
+
+    protected:
+
+        //! \reimp
+        virtual void paintEvent(QPaintEvent * event)
+        {
+            m_background.paint(*this, event->rect());
+        }
+
+    private:
+
+        BackgroundRenderer m_background;
+    };
+
+    //! Add widgets like those of the windows on top of the background.
+    void addWidgets(QDialog & dialog)
+    {
+        QGridLayout * layout = new QGridLayout(&dialog);
+        for (int i = 0; i < 4; i++)
+        {
+            layout->addWidget(new QLabel(QString("Label %1:").arg(i)), i, 0);
+            layout->addWidget(new QLineEdit(QString("text %1").arg(i)), i, 1);
+        }
+
+        layout->addWidget(new QSpinBox, 4, 1);
+        layout->addWidget(new QPushButton("Button"), 5, 1);
+    }
+
+    //! Return the processor time per frame of painting the whole
+    //! dialog, resized before every frame if resize is true.
+    double paintFrames(QDialog & dialog, bool resize)
+    {
+        const QSize size(452, 337);
+        QPixmap target(size + QSize(4 * FRAMES, 4 * FRAMES));
+
+        dialog.resize(size);
+        dialog.render(&target);
+
+        const qint64 start = Benchmark::cpuTime();
+        for (int i = 0; i < FRAMES; i++)
+        {
+            if (resize)
+            {
+                // Growing like dragging the corner of the window
+                dialog.resize(size + QSize(4 * i, 4 * i));
+            }
+
+            dialog.render(&target);
+        }
+
+        return static_cast<double>(Benchmark::cpuTime() - start) / FRAMES;
+    }
+}
+
+BENCHMARK_GROUP(backgroundBenchmarks)
+{
+    // The style sheet background the windows used before, and the
+    // cached rendering they use now
+    if (runner.wants("background/repaint-stylesheet") ||
+        runner.wants("background/resize-stylesheet"))
+    {
+        QDialog dialog;
+        dialog.setStyleSheet("QDialog { background-image: url(:/back.png) }");
+        addWidgets(dialog);
+
+        if (runner.wants("background/repaint-stylesheet"))
+        {
+            runner.report("background/repaint-stylesheet", paintFrames(dialog, false), "ns/frame");
+        }
+
+        if (runner.wants("background/resize-stylesheet"))
+        {
+            runner.report("background/resize-stylesheet", paintFrames(dialog, true), "ns/frame");
+        }
+    }
+
+    if (runner.wants("background/repaint-cached") ||
+        runner.wants("background/resize-cached"))
+    {
+        CachedDialog dialog;
+        addWidgets(dialog);
+
+        if (runner.wants("background/repaint-cached"))
+        {
+            runner.report("background/repaint-cached", paintFrames(dialog, false), "ns/frame");
+        }
+
+        if (runner.wants("background/resize-cached"))
+        {
+            const int renders = dialog.renderCount();
+            runner.report("background/resize-cached", paintFrames(dialog, true), "ns/frame");
+
+            // The cache grows in steps instead of following every resize
+            if (dialog.renderCount() - renders >= FRAMES / 2)
+            {
+                runner.fail("BackgroundRenderer rendered on every resize");
+            }
+        }
+    }
+}
@@ -0,0 +1,283 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "benchmark.h"
+#include "config.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPair>
+#include <QRegExp>
+#include <QTextStream>
+
+#include <cstdio>
+#include <ctime>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace
+{
+    //! Minimum duration of a timed run of Runner::measure().
+    const qint64 MIN_RUN_NS = 200 * 1000 * 1000;
+
+    typedef QList<QPair<const char *, Benchmark::Runner::Group> > GroupList;
+
+    GroupList & groups()
+    {
+        static GroupList groups;
+        return groups;
+    }
+
+    volatile int g_sink = 0;
+}
+
+void Benchmark::Runner::registerGroup(const char * name, Group group)
+{
+    groups() << qMakePair(name, group);
+}
+
+Benchmark::Runner::Runner(const QList<int> & sizes, const QString & filter, const QString & workDir)
+: m_sizes(sizes)
+, m_filter(filter)
+, m_workDir(workDir)
+, m_failed(false)
+{}
+
+void Benchmark::Runner::run()
+{
+    for (int i = 0; i < groups().count(); i++)
+    {
+        groups().at(i).second(*this);
+    }
+}
+
+const QList<int> & Benchmark::Runner::sizes() const
+{
+    return m_sizes;
+}
+
+const QString & Benchmark::Runner::workDir() const
+{
+    return m_workDir;
+}
+
+bool Benchmark::Runner::wants(const QString & name) const
+{
+    return name.contains(m_filter);
+}
+
+void Benchmark::Runner::measure(const QString & name, const std::function<void (int)> & op,
+    int itemsPerOp)
+{
+    if (!wants(name))
+    {
+        return;
+    }
+
+    // Warm up, then grow the iteration count until the run is long
+    // enough for the timer resolution not to matter.
+    op(1);
+
+    int    iterations = 1;
+    qint64 elapsed    = 0;
+    for (;;)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        op(iterations);
+        elapsed = timer.nsecsElapsed();
+
+        if (elapsed >= MIN_RUN_NS || iterations >= (1 << 28))
+        {
+            break;
+        }
+
+        iterations *= elapsed < MIN_RUN_NS / 10 ? 10 : 2;
+    }
+
+    report(name, static_cast<double>(elapsed) / iterations / itemsPerOp, "ns/op");
+}
+
+void Benchmark::Runner::measureOnce(const QString & name, const std::function<void ()> & op)
+{
+    if (!wants(name))
+    {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    op();
+    report(name, timer.nsecsElapsed() / 1e6, "ms");
+}
+
+void Benchmark::Runner::report(const QString & name, double value, const QString & unit)
+{
+    Result result;
+    result.name  = name;
+    result.value = value;
+    result.unit  = unit;
+    m_results << result;
+
+    std::printf("%-48s %14.2f %s\n", name.toLocal8Bit().constData(), value,
+        unit.toLocal8Bit().constData());
+    std::fflush(stdout);
+}
+
+void Benchmark::Runner::info(const QString & name, double value, const QString & unit)
+{
+    std::printf("%-48s %14.2f %s (info)\n", name.toLocal8Bit().constData(), value,
+        unit.toLocal8Bit().constData());
+    std::fflush(stdout);
+}
+
+void Benchmark::Runner::fail(const QString & message)
+{
+    std::printf("FAILED: %s\n", message.toLocal8Bit().constData());
+    m_failed = true;
+}
+
+bool Benchmark::Runner::failed() const
+{
+    return m_failed;
+}
+
+const QList<Benchmark::Result> & Benchmark::Runner::results() const
+{
+    return m_results;
+}
+
+LoginIO::LoginList Benchmark::makeLogins(int count, unsigned int seed)
+{
+    static const char * const hosts[] =
+    {
+        "mail", "intranet", "git", "wiki", "db", "backup", "build", "vpn"
+    };
+
+    // A fixed LCG so that the data doesn't depend on the platform's rand()
+    quint32 state = seed;
+
+    LoginIO::LoginList logins;
+    logins.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        state = state * 1664525 + 1013904223;
+
+        // The index keeps the URLs unique, the rest just varies the content
+        const QString url = QString("%1-%2.%3.example.com")
+            .arg(hosts[(state >> 8) % 8])
+            .arg(i, 0, 36)
+            .arg(state >> 20, 0, 36);
+        const QString user = QString("svc-account-%1").arg((state >> 12) % 16);
+
+        logins << LoginData(url, user, 8 + (state >> 4) % 25);
+    }
+
+    return logins;
+}
+
+QString Benchmark::encodeReference(const Md5::Digest & digest, unsigned int length)
+{
+    // Generate a base64 encoding of md5
+    QByteArray hashed(reinterpret_cast<const char *>(digest), Md5::DIGEST_SIZE);
+    hashed = hashed.toHex().toBase64();
+
+    // Replace possible +, / and = with A, B and C, respectively.
+    hashed = hashed.replace('+', 'A').replace('/', 'B').replace('=', 'C');
+
+    // Remove '\n' and return n first chars
+    return hashed.simplified().left(length);
+}
+
+bool Benchmark::writeJson(const QList<Result> & results, const QString & fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    // One result per line keeps the file easy to diff and to read back
+    QTextStream out(&file);
+    out << "{\n";
+    out << "  \"version\": \"" << Config::VERSION << "\",\n";
+    out << "  \"results\": [\n";
+    for (int i = 0; i < results.count(); i++)
+    {
+        out << "    {\"name\": \"" << results.at(i).name
+            << "\", \"value\": " << QString::number(results.at(i).value, 'g', 10)
+            << ", \"unit\": \"" << results.at(i).unit << "\"}"
+            << (i + 1 < results.count() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+    return true;
+}
+
+bool Benchmark::readJson(const QString & fileName, QList<Result> & rResults)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return false;
+    }
+
+    QRegExp entry("\"name\":\\s*\"([^\"]*)\",\\s*\"value\":\\s*([-+0-9.eE]+),\\s*\"unit\":\\s*\"([^\"]*)\"");
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        const QString line = in.readLine();
+        if (entry.indexIn(line) != -1)
+        {
+            Result result;
+            result.name  = entry.cap(1);
+            result.value = entry.cap(2).toDouble();
+            result.unit  = entry.cap(3);
+            rResults << result;
+        }
+    }
+
+    return true;
+}
+
+void Benchmark::consume(int value)
+{
+    g_sink = g_sink + value;
+}
+
+qint64 Benchmark::heapUsage()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return static_cast<qint64>(info.uordblks) + info.hblkhd;
+#elif defined(__GLIBC__)
+    const struct mallinfo info = mallinfo();
+    return static_cast<qint64>(info.uordblks) + info.hblkhd;
+#else
+    return -1;
+#endif
+}
+
+qint64 Benchmark::cpuTime()
+{
+    // CLOCKS_PER_SEC is 1000000 on POSIX and 1000 on Windows
+    return static_cast<qint64>(std::clock()) * (1000000000 / CLOCKS_PER_SEC);
+}
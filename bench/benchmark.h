@@ -0,0 +1,151 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+
+#include "loginio.h"
+#include "md5.h"
+
+//! A minimal benchmark harness. Benchmarks are grouped into functions
+//! registered with BENCHMARK_GROUP, which report their results through
+//! the Runner. Lower values are always better.
+namespace Benchmark
+{
+    //! A single measurement.
+    struct Result
+    {
+        QString name;
+        double  value;
+        QString unit;
+    };
+
+    //! Runs the registered groups and collects the results.
+    class Runner
+    {
+    public:
+
+        //! Function that runs a group of benchmarks.
+        typedef void (*Group)(Runner & runner);
+
+        //! Register a group. Used by BENCHMARK_GROUP.
+        static void registerGroup(const char * name, Group group);
+
+        //! Constructor. Files created by the benchmarks go to workDir.
+        Runner(const QList<int> & sizes, const QString & filter, const QString & workDir);
+
+        //! Run all registered groups.
+        void run();
+
+        //! Login counts the macrobenchmarks should run at.
+        const QList<int> & sizes() const;
+
+        //! Directory for temporary files.
+        const QString & workDir() const;
+
+        //! Return true if the named benchmark passes the filter.
+        //! Groups can use this to skip expensive setup.
+        bool wants(const QString & name) const;
+
+        //! Time op(n), which must run the operation n times, with a growing
+        //! n until the run takes long enough and report the time per operation.
+        //! If a single operation processes several items, itemsPerOp makes
+        //! the reported time per item instead.
+        void measure(const QString & name, const std::function<void (int)> & op,
+            int itemsPerOp = 1);
+
+        //! Time a single run of op and report it in milliseconds.
+        void measureOnce(const QString & name, const std::function<void ()> & op);
+
+        //! Report a value measured by the group itself.
+        void report(const QString & name, double value, const QString & unit);
+
+        //! Print a value that is not a result, such as one where higher is
+        //! better. It is neither written out nor compared to a baseline.
+        void info(const QString & name, double value, const QString & unit);
+
+        //! Report a failed correctness check.
+        void fail(const QString & message);
+
+        //! Return true if a check has failed.
+        bool failed() const;
+
+        //! All results so far.
+        const QList<Result> & results() const;
+
+    private:
+
+        QList<int> m_sizes;
+
+        QString m_filter;
+
+        QString m_workDir;
+
+        bool m_failed;
+
+        QList<Result> m_results;
+    };
+
+    //! Registers a group at static initialization.
+    class Registrar
+    {
+    public:
+
+        Registrar(const char * name, Runner::Group group)
+        {
+            Runner::registerGroup(name, group);
+        }
+    };
+
+    //! Deterministic synthetic logins. The same count and seed
+    //! always give the same logins with unique URLs.
+    LoginIO::LoginList makeLogins(int count, unsigned int seed = 1);
+
+    //! The original hex -> base64 -> substitution chain of Encoder built
+    //! on QByteArray. The reference for Encoder::encode().
+    QString encodeReference(const Md5::Digest & digest, unsigned int length);
+
+    //! Write the results as JSON.
+    bool writeJson(const QList<Result> & results, const QString & fileName);
+
+    //! Read results written by writeJson().
+    bool readJson(const QString & fileName, QList<Result> & rResults);
+
+    //! Keep the compiler from optimizing away a computed value.
+    void consume(int value);
+
+    //! Bytes currently allocated from the heap, or -1 if the
+    //! platform can't tell.
+    qint64 heapUsage();
+
+    //! Processor time used by the process so far in nanoseconds.
+    //! Unlike the wall clock it excludes the time spent waiting.
+    qint64 cpuTime();
+}
+
+//! Define and register a benchmark group.
+#define BENCHMARK_GROUP(name) \
+    static void name(Benchmark::Runner & runner); \
+    static Benchmark::Registrar name##Registrar(#name, name); \
+    static void name(Benchmark::Runner & runner)
+
+#endif // BENCHMARK_H
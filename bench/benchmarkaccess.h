@@ -0,0 +1,67 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef BENCHMARKACCESS_H
+#define BENCHMARKACCESS_H
+
+#include <QComboBox>
+#include <QLineEdit>
+
+#include "mainwindow.h"
+
+//! Gives the benchmarks access to the internals of MainWindow.
+//! MainWindow declares this class as a friend.
+class BenchmarkAccess
+{
+public:
+
+    //! Return the number of logins of the window.
+    static int loginCount(const MainWindow & window)
+    {
+        return window.m_logins.count();
+    }
+
+    static void loadSettings(MainWindow & window)
+    {
+        window.loadSettings();
+    }
+
+    //! Set the text of the url field like typing does.
+    static void setUrlText(MainWindow & window, const QString & text)
+    {
+        window.m_urlCombo->setEditText(text);
+    }
+
+    //! Set the text of the user name field like typing does.
+    static void setUserText(MainWindow & window, const QString & text)
+    {
+        window.m_userEdit->setText(text);
+    }
+
+    //! Slot invocations made for the input changes so far.
+    static int inputSlotCalls(const MainWindow & window)
+    {
+        return window.m_inputCounters.slotCalls;
+    }
+
+    //! Login lookups made for the input changes so far.
+    static int inputLookups(const MainWindow & window)
+    {
+        return window.m_inputCounters.lookups;
+    }
+};
+
+#endif // BENCHMARKACCESS_H
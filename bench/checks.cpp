@@ -0,0 +1,547 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Correctness checks of the optimized code paths against the test vectors
+// of their specifications and the straightforward implementations they
+// replace. A failed check fails the benchmark run.
+
+#include "benchmark.h"
+#include "encoder.h"
+#include "engine.h"
+#include "generator.h"
+#include "kdf.h"
+#include "logindata.h"
+#include "loginio.h"
+#include "md5.h"
+#include "sha256.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDomDocument>
+#include <QFile>
+#include <QScopedArrayPointer>
+#include <QStringList>
+#include <QVector>
+
+#include <cstring>
+
+namespace
+{
+    //! Lane counts of the MD5 kernels.
+    const int LANE_COUNTS[] = {1, 4, 8, 16};
+    const int LANE_COUNT_COUNT = sizeof(LANE_COUNTS) / sizeof(LANE_COUNTS[0]);
+
+    QByteArray hex(const quint8 * data, int size)
+    {
+        return QByteArray(reinterpret_cast<const char *>(data), size).toHex();
+    }
+
+    //! The original password generator built on QCryptographicHash.
+    QString referencePassword(const QByteArray & message, unsigned int length)
+    {
+        QByteArray hashed = QCryptographicHash::hash(message, QCryptographicHash::Md5);
+        hashed = hashed.toHex().toBase64();
+        hashed = hashed.replace('+', 'A').replace('/', 'B').replace('=', 'C');
+        return hashed.simplified().left(length);
+    }
+
+    //! Every supported MD5 kernel against the RFC 1321 test suite, both
+    //! from the start and continuing from a midstate.
+    bool checkMd5Suite()
+    {
+        // RFC 1321, appendix A.5
+        static const char * const messages[] =
+        {
+            "",
+            "a",
+            "abc",
+            "message digest",
+            "abcdefghijklmnopqrstuvwxyz",
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+            "12345678901234567890123456789012345678901234567890123456789012345678901234567890"
+        };
+
+        static const char * const digests[] =
+        {
+            "d41d8cd98f00b204e9800998ecf8427e",
+            "0cc175b9c0f1b6a831c399e269772661",
+            "900150983cd24fb0d6963f7d28e17f72",
+            "f96b697d7cb7938d525a2f31aaf161d0",
+            "c3fcd3d76192e4007dfb496cca67e13b",
+            "d174ab98d277d9f5a5611c2c9f419d9f",
+            "57edf4a22be3c955ac49da2e2107b67a"
+        };
+
+        // Cycle the suite a few times so that every kernel sees full groups,
+        // a partial last group and lanes with different block counts.
+        const int suiteSize = sizeof(messages) / sizeof(messages[0]);
+        const int count     = suiteSize * 5;
+
+        const char * data[count];
+        int          sizes[count];
+        Md5::Digest  result[count];
+        for (int i = 0; i < count; i++)
+        {
+            data[i]  = messages[i % suiteSize];
+            sizes[i] = std::strlen(data[i]);
+        }
+
+        for (int j = 0; j < LANE_COUNT_COUNT; j++)
+        {
+            if (!Md5::isSupported(LANE_COUNTS[j]))
+            {
+                continue;
+            }
+
+            Md5::hashMany(data, sizes, count, result, LANE_COUNTS[j]);
+            for (int i = 0; i < count; i++)
+            {
+                if (hex(result[i], Md5::DIGEST_SIZE) != digests[i % suiteSize])
+                {
+                    return false;
+                }
+            }
+        }
+
+        // The last message is longer than a block, continue it from its midstate
+        const char * const  longMessage = messages[suiteSize - 1];
+        const int           longSize    = std::strlen(longMessage);
+        const Md5::Midstate prefix      = Md5::midstate(longMessage, longSize);
+        const int           prefixSize  = static_cast<int>(prefix.size);
+        if (prefixSize != 64)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            data[i]  = longMessage + prefixSize;
+            sizes[i] = longSize - prefixSize;
+        }
+
+        for (int j = 0; j < LANE_COUNT_COUNT; j++)
+        {
+            if (!Md5::isSupported(LANE_COUNTS[j]))
+            {
+                continue;
+            }
+
+            Md5::hashMany(prefix, data, sizes, count, result, LANE_COUNTS[j]);
+            for (int i = 0; i < count; i++)
+            {
+                if (hex(result[i], Md5::DIGEST_SIZE) != digests[suiteSize - 1])
+                {
+                    return false;
+                }
+            }
+        }
+
+        Md5::Context context(prefix);
+        context.update(longMessage + prefixSize, longSize - prefixSize);
+        context.finish(result[0]);
+        return hex(result[0], Md5::DIGEST_SIZE) == digests[suiteSize - 1];
+    }
+
+    //! Every supported MD5 kernel and Engine against QCryptographicHash and
+    //! the original generator on master + url + user messages, with a master
+    //! shorter than a block and one continued from its midstate.
+    bool checkMd5Logins()
+    {
+        const LoginIO::LoginList logins = Benchmark::makeLogins(257);
+        const int                count  = logins.count();
+
+        const QString masters[] =
+        {
+            "correct horse battery staple",
+            QString("a master password longer than a single md5 block ").repeated(3)
+        };
+
+        for (int m = 0; m < 2; m++)
+        {
+            const QByteArray master = masters[m].toLatin1();
+
+            QVector<QByteArray> messages;
+            for (int i = 0; i < count; i++)
+            {
+                messages << master + (logins.at(i).url() + logins.at(i).userName()).toLatin1();
+            }
+
+            const Md5::Midstate prefix     = Md5::midstate(master.constData(), master.size());
+            const int           prefixSize = static_cast<int>(prefix.size);
+
+            QVector<const char *> data;
+            QVector<int>          sizes;
+            QVector<const char *> suffixes;
+            QVector<int>          suffixSizes;
+            QVector<QByteArray>   expected;
+            for (int i = 0; i < count; i++)
+            {
+                data        << messages.at(i).constData();
+                sizes       << messages.at(i).size();
+                suffixes    << messages.at(i).constData() + prefixSize;
+                suffixSizes << messages.at(i).size() - prefixSize;
+                expected    << QCryptographicHash::hash(messages.at(i), QCryptographicHash::Md5);
+            }
+
+            QScopedArrayPointer<Md5::Digest> result(new Md5::Digest[count]);
+            for (int j = 0; j < LANE_COUNT_COUNT; j++)
+            {
+                if (!Md5::isSupported(LANE_COUNTS[j]))
+                {
+                    continue;
+                }
+
+                Md5::hashMany(data.constData(), sizes.constData(), count, result.data(),
+                    LANE_COUNTS[j]);
+                for (int i = 0; i < count; i++)
+                {
+                    if (std::memcmp(result[i], expected.at(i).constData(), Md5::DIGEST_SIZE))
+                    {
+                        return false;
+                    }
+                }
+
+                Md5::hashMany(prefix, suffixes.constData(), suffixSizes.constData(), count,
+                    result.data(), LANE_COUNTS[j]);
+                for (int i = 0; i < count; i++)
+                {
+                    if (std::memcmp(result[i], expected.at(i).constData(), Md5::DIGEST_SIZE))
+                    {
+                        return false;
+                    }
+                }
+            }
+
+            QVector<QString> passwords;
+            Engine::generateBatch(masters[m], logins, passwords);
+            for (int i = 0; i < count; i++)
+            {
+                const LoginData & login = logins.at(i);
+                const QString reference = referencePassword(messages.at(i), login.passwordLength());
+                if (passwords.at(i) != reference ||
+                    Engine::generate(masters[m], login.url(), login.userName(),
+                        login.passwordLength()) != reference)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //! Encoder::encode() against Benchmark::encodeReference() at every length
+    //! for every value of every pair of adjacent nibbles. Each output
+    //! character depends on at most two adjacent nibbles, so this covers
+    //! every digest.
+    bool checkEncoder()
+    {
+        for (int first = 0; first + 1 < Md5::DIGEST_SIZE * 2; first++)
+        {
+            for (int value = 0; value < 256; value++)
+            {
+                quint8 nibbles[Md5::DIGEST_SIZE * 2] = {0};
+                nibbles[first]     = value >> 4;
+                nibbles[first + 1] = value & 0xf;
+
+                Md5::Digest digest;
+                for (int i = 0; i < Md5::DIGEST_SIZE; i++)
+                {
+                    digest[i] = (nibbles[i * 2] << 4) | nibbles[i * 2 + 1];
+                }
+
+                const QString expected = Benchmark::encodeReference(digest, Encoder::OUTPUT_SIZE);
+                for (unsigned int length = 0; length <= Encoder::OUTPUT_SIZE + 1; length++)
+                {
+                    char password[Encoder::OUTPUT_SIZE + 1];
+                    const unsigned int size = Encoder::encode(digest, length, password);
+                    if (size != qMin(length, Encoder::OUTPUT_SIZE) ||
+                        QString::fromLatin1(password, size) != expected.left(size))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //! SHA-256 and HMAC-SHA-256 against the FIPS 180-4 and RFC 4231 test
+    //! vectors, and the digest path of the MAC against the generic one.
+    bool checkSha256()
+    {
+        // FIPS 180-4 examples and a message spanning several blocks
+        static const char * const messages[] =
+        {
+            "",
+            "abc",
+            "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+            "12345678901234567890123456789012345678901234567890123456789012345678901234567890"
+        };
+
+        static const char * const digests[] =
+        {
+            "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+            "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+            "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+            "f371bc4a311f2b009eef952dd83ca80e2b60026c8e935592d0f9c308453c813e"
+        };
+
+        // RFC 4231 test cases 2 and 6: a short key and a key longer than a block
+        const QByteArray longKey(131, '\xaa');
+        const struct
+        {
+            QByteArray key;
+            const char * data;
+            const char * mac;
+        } macs[] =
+        {
+            {QByteArray("Jefe"), "what do ya want for nothing?",
+                "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+            {longKey, "Test Using Larger Than Block-Size Key - Hash Key First",
+                "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"}
+        };
+
+        Sha256::Digest digest;
+        for (unsigned int i = 0; i < sizeof(messages) / sizeof(messages[0]); i++)
+        {
+            Sha256::hash(messages[i], std::strlen(messages[i]), digest);
+            if (hex(digest, Sha256::DIGEST_SIZE) != digests[i])
+            {
+                return false;
+            }
+        }
+
+        for (unsigned int i = 0; i < sizeof(macs) / sizeof(macs[0]); i++)
+        {
+            const Sha256::Hmac hmac(macs[i].key.constData(), macs[i].key.size());
+            hmac.mac(macs[i].data, std::strlen(macs[i].data), digest);
+            if (hex(digest, Sha256::DIGEST_SIZE) != macs[i].mac)
+            {
+                return false;
+            }
+
+            // The digest path must agree with the generic one
+            Sha256::Digest expected;
+            hmac.mac(reinterpret_cast<const char *>(digest), Sha256::DIGEST_SIZE, expected);
+            hmac.macDigest(digest, digest);
+            if (std::memcmp(digest, expected, Sha256::DIGEST_SIZE) != 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //! PBKDF2 and scrypt against the RFC 7914 test vectors, also with the
+    //! lanes of scrypt split over threads.
+    bool checkKdf()
+    {
+        // RFC 7914, section 11 and 12
+        static const char pbkdf2Key[] =
+            "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc"
+            "49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783";
+
+        static const char scryptKey[] =
+            "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+            "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640";
+
+        quint8 key[64];
+        Kdf::pbkdf2("passwd", 6, "salt", 4, 1, key, sizeof(key));
+        if (hex(key, sizeof(key)) != pbkdf2Key)
+        {
+            return false;
+        }
+
+        // The lanes must give the same result however they are split
+        const int threadCounts[] = {1, 3, 0};
+        for (unsigned int i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); i++)
+        {
+            Kdf::scrypt("password", 8, "NaCl", 4, 1024, 8, 16, key, sizeof(key), threadCounts[i]);
+            if (hex(key, sizeof(key)) != scryptKey)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //! The password of a generator variant built with the hex, base64 and
+    //! replace chain on QByteArray.
+    QByteArray generatorReference(const Generator::Variant & variant, const char * data, int size)
+    {
+        quint8 digest[Sha256::DIGEST_SIZE];
+        if (variant.version & Generator::SHA256)
+        {
+            Sha256::hash(data, size, *reinterpret_cast<Sha256::Digest *>(digest));
+        }
+        else
+        {
+            Md5::hash(data, size, *reinterpret_cast<Md5::Digest *>(digest));
+        }
+
+        QByteArray encoded(reinterpret_cast<const char *>(digest), variant.digestSize);
+        if (!(variant.version & Generator::BASE64))
+        {
+            encoded = encoded.toHex();
+        }
+
+        encoded = encoded.toBase64();
+        if (!(variant.version & Generator::SYMBOLS))
+        {
+            encoded = encoded.replace('+', 'A').replace('/', 'B').replace('=', 'C');
+        }
+
+        return encoded;
+    }
+
+    //! Every generator kernel at every length against the reference.
+    bool checkGenerator()
+    {
+        for (int version = 0; version < Generator::VERSION_COUNT; version++)
+        {
+            const Generator::Variant * variant = Generator::find(version);
+            if (!variant || variant->version != version)
+            {
+                return false;
+            }
+
+            for (int i = 0; i < 64; i++)
+            {
+                const QByteArray message  = QByteArray::number(i);
+                const QByteArray expected = generatorReference(*variant,
+                    message.constData(), message.size());
+                if (static_cast<unsigned int>(expected.size()) != variant->outputSize)
+                {
+                    return false;
+                }
+
+                char password[Generator::MAX_OUTPUT_SIZE + 1];
+                for (unsigned int length = 0; length <= variant->outputSize + 1; length++)
+                {
+                    const unsigned int size = variant->generate(message.constData(),
+                        message.size(), length, password);
+                    if (size != qMin(length, variant->outputSize) ||
+                        QByteArray(password) != expected.left(size))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+
+    //! Logins that need the key derivation must be invisible to the
+    //! importer of older versions, which reads the <login> elements of
+    //! a .fpm file with QDomDocument, and come back from LoginReader.
+    bool checkFpmCompatibility(const QString & fileName)
+    {
+        LoginIO::LoginList logins;
+        logins << LoginData("legacy.example.com", "user", 12);
+        logins << LoginData("pbkdf2.example.com", "user", 14);
+        logins.last().setKdf(Kdf::Params(Kdf::PBKDF2_SHA256, 1000));
+        logins << LoginData("scrypt.example.com", "user", 16);
+        logins.last().setKdf(Kdf::Params(Kdf::SCRYPT, 10));
+
+        if (!LoginIO::exportLogins(logins, fileName))
+        {
+            return false;
+        }
+
+        QDomDocument doc;
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly) || !doc.setContent(&file))
+        {
+            return false;
+        }
+
+        QStringList oldUrls;
+        for (QDomNode node = doc.documentElement().firstChild(); !node.isNull();
+            node = node.nextSibling())
+        {
+            const QDomElement tag = node.toElement();
+            if (!tag.isNull() && tag.nodeName() == "login")
+            {
+                oldUrls << tag.attribute("url", "");
+            }
+        }
+
+        if (oldUrls != QStringList(logins.first().url()))
+        {
+            return false;
+        }
+
+        LoginIO::LoginList imported;
+        if (!LoginIO::importLogins(imported, fileName) || imported.count() != logins.count())
+        {
+            return false;
+        }
+
+        for (int i = 0; i < logins.count(); i++)
+        {
+            if (imported.at(i).url() != logins.at(i).url() ||
+                imported.at(i).kdf() != logins.at(i).kdf())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+BENCHMARK_GROUP(checks)
+{
+    if (!checkMd5Suite())
+    {
+        runner.fail("md5: RFC 1321 test suite");
+    }
+
+    if (!checkMd5Logins())
+    {
+        runner.fail("md5: logins against QCryptographicHash");
+    }
+
+    if (!checkEncoder())
+    {
+        runner.fail("encoder: against the reference encoding");
+    }
+
+    if (!checkSha256())
+    {
+        runner.fail("sha256: FIPS 180-4 and RFC 4231 test vectors");
+    }
+
+    if (!checkKdf())
+    {
+        runner.fail("kdf: RFC 7914 test vectors");
+    }
+
+    if (!checkGenerator())
+    {
+        runner.fail("generator: against the QByteArray chain");
+    }
+
+    if (!checkFpmCompatibility(runner.workDir() + "/checks.fpm"))
+    {
+        runner.fail("loginio: key derivation logins hidden from older versions");
+    }
+}
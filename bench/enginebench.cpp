@@ -0,0 +1,236 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "benchmark.h"
+#include "encoder.h"
+#include "engine.h"
+#include "kdf.h"
+#include "md5.h"
+#include "sha256.h"
+
+#include <QByteArray>
+#include <QScopedArrayPointer>
+#include <QVector>
+
+BENCHMARK_GROUP(engineBenchmarks)
+{
+    const QString            master("correct horse battery staple");
+    const LoginIO::LoginList logins = Benchmark::makeLogins(1024);
+    const int                count  = logins.count();
+
+    runner.measure("engine/generate", [&](int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+                login.passwordLength()).size());
+        }
+    });
+
+    runner.measure("engine/generate-buffer", [&](int n)
+    {
+        Engine::PasswordBuffer password;
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+                login.passwordLength(), password));
+        }
+    });
+
+    // Preparing the master once, also for a master longer than an MD5
+    // block and for the cheapest key derivation, where the keyed HMAC
+    // saves half of the compressions
+    const QString longMaster = master + master + master;
+    const Kdf::Params pbkdf2Once(Kdf::PBKDF2_SHA256, 1);
+    const Engine::Master prepared(master);
+    const Engine::Master preparedLong(longMaster);
+
+    runner.measure("engine/generate-long", [&](int n)
+    {
+        Engine::PasswordBuffer password;
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(Engine::generate(longMaster, login.url(), login.userName(),
+                login.passwordLength(), password));
+        }
+    });
+
+    runner.measure("engine/generate-long-prepared", [&](int n)
+    {
+        Engine::PasswordBuffer password;
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(preparedLong.generate(login.url(), login.userName(),
+                login.passwordLength(), Kdf::Params(), password));
+        }
+    });
+
+    runner.measure("engine/generate-pbkdf2-1", [&](int n)
+    {
+        Engine::PasswordBuffer password;
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+                login.passwordLength(), pbkdf2Once, password));
+        }
+    });
+
+    runner.measure("engine/generate-pbkdf2-1-prepared", [&](int n)
+    {
+        Engine::PasswordBuffer password;
+        for (int i = 0; i < n; i++)
+        {
+            const LoginData & login = logins.at(i % count);
+            Benchmark::consume(prepared.generate(login.url(), login.userName(),
+                login.passwordLength(), pbkdf2Once, password));
+        }
+    });
+
+    runner.measure("engine/generate-batch", [&](int n)
+    {
+        QVector<QString> passwords;
+        for (int i = 0; i < n; i++)
+        {
+            Engine::generateBatch(master, logins, passwords);
+            Benchmark::consume(passwords.count());
+        }
+    }, count);
+
+    runner.measure("engine/generate-batch-long", [&](int n)
+    {
+        QVector<QString> passwords;
+        for (int i = 0; i < n; i++)
+        {
+            Engine::generateBatch(longMaster, logins, passwords);
+            Benchmark::consume(passwords.count());
+        }
+    }, count);
+
+    runner.measure("engine/generate-batch-long-prepared", [&](int n)
+    {
+        QVector<QString> passwords;
+        for (int i = 0; i < n; i++)
+        {
+            Engine::generateBatch(preparedLong, logins, passwords);
+            Benchmark::consume(passwords.count());
+        }
+    }, count);
+
+    // The password encoder against the original hex -> base64 -> replace chain
+    Md5::Digest digests[64];
+    for (int i = 0; i < 64; i++)
+    {
+        const QByteArray message = QByteArray::number(i);
+        Md5::hash(message.constData(), message.size(), digests[i]);
+    }
+
+    const unsigned int lengths[] = {8, 32};
+    for (int j = 0; j < 2; j++)
+    {
+        const unsigned int length = lengths[j];
+
+        runner.measure(QString("encoder/fused/%1").arg(length), [&](int n)
+        {
+            char password[Encoder::OUTPUT_SIZE + 1];
+            for (int i = 0; i < n; i++)
+            {
+                Benchmark::consume(Encoder::encode(digests[i % 64], length, password));
+            }
+        });
+
+        runner.measure(QString("encoder/reference/%1").arg(length), [&](int n)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                Benchmark::consume(Benchmark::encodeReference(digests[i % 64], length).size());
+            }
+        });
+    }
+
+    // MD5 per message at every supported lane width
+    QVector<QByteArray>   messages;
+    QVector<const char *> data;
+    QVector<int>          sizes;
+    for (int i = 0; i < count; i++)
+    {
+        messages << (master + logins.at(i).url() + logins.at(i).userName()).toLatin1();
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        data  << messages.at(i).constData();
+        sizes << messages.at(i).size();
+    }
+
+    QScopedArrayPointer<Md5::Digest> results(new Md5::Digest[count]);
+    const int laneCounts[] = {1, 4, 8, 16};
+    for (int j = 0; j < 4; j++)
+    {
+        const int lanes = laneCounts[j];
+        if (!Md5::isSupported(lanes))
+        {
+            continue;
+        }
+
+        runner.measure(QString("md5/lanes-%1").arg(lanes), [&](int n)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                Md5::hashMany(data.constData(), sizes.constData(), count, results.data(), lanes);
+                Benchmark::consume(results[0][0]);
+            }
+        }, count);
+    }
+
+    // A single derivation at fixed costs, with the scrypt lanes both
+    // in parallel and on one thread
+    const LoginData & login = logins.at(0);
+    Engine::PasswordBuffer password;
+
+    const Kdf::Params pbkdf2(Kdf::PBKDF2_SHA256, 100000);
+    runner.measureOnce("kdf/pbkdf2-100000", [&]()
+    {
+        Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+            login.passwordLength(), pbkdf2, password));
+    });
+
+    const Kdf::Params scrypt(Kdf::SCRYPT, 14);
+    runner.measureOnce("kdf/scrypt-14", [&]()
+    {
+        Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+            login.passwordLength(), scrypt, password));
+    });
+
+    runner.measureOnce("kdf/scrypt-14-1-thread", [&]()
+    {
+        Benchmark::consume(Engine::generate(master, login.url(), login.userName(),
+            login.passwordLength(), scrypt, password, 1));
+    });
+
+    // Costs chosen for new logins on this machine. Higher is better and
+    // they vary from run to run, so they are not compared to a baseline.
+    if (runner.wants("kdf/calibrated"))
+    {
+        runner.info("kdf/calibrated-pbkdf2", Kdf::calibrate(Kdf::PBKDF2_SHA256, 250).cost,
+            "iterations");
+        runner.info("kdf/calibrated-scrypt", Kdf::calibrate(Kdf::SCRYPT, 250).cost, "log2 N");
+    }
+}
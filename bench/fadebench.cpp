@@ -0,0 +1,175 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QColor>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLineEdit>
+#include <QPalette>
+#include <QTimerEvent>
+
+#include "benchmark.h"
+#include "fadinglineedit.h"
+
+namespace
+{
+    //! Duration of the measured fades. The windows fade for the
+    //! login delay, 15 s by default, so scale the results accordingly.
+    const int FADE_MS = 3000;
+
+    //! The fade the window used before: the text color is set through
+    //! the palette on every frame of a 25 fps time line.
+    class PaletteFadeEdit : public QLineEdit
+    {
+    public:
+
+        PaletteFadeEdit()
+        : m_timerId(0)
+        , m_frame(0)
+        , m_frameCount(0)
+        {}
+
+        void startFade()
+        {
+            m_frame = 0;
+            m_clock.start();
+            m_timerId = startTimer(40);
+        }
+
+        bool isFading() const
+        {
+            return m_timerId != 0;
+        }
+
+        int frameCount() const
+        {
+            return m_frameCount;
+        }
+
+    protected:
+
+        //! \reimp
+        virtual void timerEvent(QTimerEvent * event)
+        {
+            if (event->timerId() != m_timerId)
+            {
+                QLineEdit::timerEvent(event);
+                return;
+            }
+
+            const int frame = static_cast<int>(qMin<qint64>(m_clock.elapsed(), FADE_MS) * 255 / FADE_MS);
+            if (frame != m_frame)
+            {
+                m_frame = frame;
+                m_frameCount++;
+
+                QColor color = QColor();
+                color.setAlpha(255 - frame);
+                QPalette palette = QPalette(this->palette());
+                palette.setColor(QPalette::Text, color);
+                setPalette(palette);
+            }
+
+            if (frame == 255)
+            {
+                killTimer(m_timerId);
+                m_timerId = 0;
+            }
+        }
+
+    private:
+
+        int m_timerId;
+
+        int m_frame;
+
+        int m_frameCount;
+
+        QElapsedTimer m_clock;
+    };
+
+    //! Run the event loop until the fade is over and return the
+    //! processor time used in ms.
+    template <typename Edit>
+    double runFade(Edit & edit)
+    {
+        const qint64 start = Benchmark::cpuTime();
+        while (edit.isFading())
+        {
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        }
+
+        return (Benchmark::cpuTime() - start) / 1e6;
+    }
+}
+
+BENCHMARK_GROUP(fadeBenchmarks)
+{
+    if (runner.wants("fade/palette-cpu") || runner.wants("fade/palette-frames"))
+    {
+        PaletteFadeEdit edit;
+        edit.setText("Xq3v9FbT2mKw");
+        edit.show();
+
+        edit.startFade();
+        const double cpu = runFade(edit);
+        if (runner.wants("fade/palette-cpu"))
+        {
+            runner.report("fade/palette-cpu", cpu, "ms");
+        }
+
+        if (runner.wants("fade/palette-frames"))
+        {
+            runner.report("fade/palette-frames", edit.frameCount(), "frames");
+        }
+    }
+
+    if (runner.wants("fade/opacity-cpu") || runner.wants("fade/opacity-frames") ||
+        runner.wants("fade/hidden-cpu"))
+    {
+        FadingLineEdit edit;
+        edit.setText("Xq3v9FbT2mKw");
+        edit.show();
+
+        edit.startFade(FADE_MS);
+        const double cpu = runFade(edit);
+        if (runner.wants("fade/opacity-cpu"))
+        {
+            runner.report("fade/opacity-cpu", cpu, "ms");
+        }
+
+        if (runner.wants("fade/opacity-frames"))
+        {
+            runner.report("fade/opacity-frames", edit.frameCount(), "frames");
+        }
+
+        // A hidden window paints no frames, only the end of the fade fires
+        edit.hide();
+        const int frames = edit.frameCount();
+        edit.startFade(FADE_MS);
+
+        const double hiddenCpu = runFade(edit);
+        if (runner.wants("fade/hidden-cpu"))
+        {
+            runner.report("fade/hidden-cpu", hiddenCpu, "ms");
+        }
+
+        if (edit.frameCount() - frames > 1)
+        {
+            runner.fail("FadingLineEdit painted while hidden");
+        }
+    }
+}
@@ -0,0 +1,77 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QByteArray>
+#include <QVector>
+
+#include "benchmark.h"
+#include "generator.h"
+
+BENCHMARK_GROUP(generatorBenchmarks)
+{
+    // Messages like the ones of Engine: master + url + user
+    const QString            master("correct horse battery staple");
+    const LoginIO::LoginList logins = Benchmark::makeLogins(1024);
+    const int                count  = logins.count();
+
+    QVector<QByteArray> messages;
+    for (int i = 0; i < count; i++)
+    {
+        messages << (master + logins.at(i).url() + logins.at(i).userName()).toLatin1();
+    }
+
+    // Digests long enough for every hash
+    quint8 digests[64][Sha256::DIGEST_SIZE];
+    for (int i = 0; i < 64; i++)
+    {
+        const QByteArray & message = messages.at(i);
+        Sha256::hash(message.constData(), message.size(),
+            *reinterpret_cast<Sha256::Digest *>(digests[i]));
+    }
+
+    // Every kernel of the registry, the full generation and the encoding
+    // alone, at the default password length and at the full encoding
+    for (int version = 0; version < Generator::VERSION_COUNT; version++)
+    {
+        const Generator::Variant * variant = Generator::find(version);
+        const QString name = QString("generator/%1").arg(variant->name);
+
+        runner.measure(name + "/generate-8", [&](int n)
+        {
+            char password[Generator::MAX_OUTPUT_SIZE + 1];
+            for (int i = 0; i < n; i++)
+            {
+                const QByteArray & message = messages.at(i % count);
+                Benchmark::consume(variant->generate(message.constData(), message.size(),
+                    8, password));
+            }
+        });
+
+        const unsigned int lengths[] = {8, variant->outputSize};
+        for (int j = 0; j < 2; j++)
+        {
+            const unsigned int length = lengths[j];
+            runner.measure(QString("%1/encode-%2").arg(name).arg(length), [&](int n)
+            {
+                char password[Generator::MAX_OUTPUT_SIZE + 1];
+                for (int i = 0; i < n; i++)
+                {
+                    Benchmark::consume(variant->encode(digests[i % 64], length, password));
+                }
+            });
+        }
+    }
+}
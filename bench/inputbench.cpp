@@ -0,0 +1,91 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QCoreApplication>
+#include <QString>
+
+#include "benchmark.h"
+#include "benchmarkaccess.h"
+
+namespace
+{
+    //! Url typed one character at a time.
+    const char * TYPED_URL = "accounts.example.com";
+
+    //! User name typed one character at a time.
+    const char * TYPED_USER = "john.doe";
+
+    //! Type the text into a field one key per event loop turn
+    //! and return the number of keys.
+    int type(MainWindow & window, const QString & text,
+        void (*setText)(MainWindow &, const QString &))
+    {
+        for (int i = 1; i <= text.length(); i++)
+        {
+            setText(window, text.left(i));
+            QCoreApplication::processEvents();
+        }
+
+        return text.length();
+    }
+}
+
+BENCHMARK_GROUP(inputBenchmarks)
+{
+    if (!runner.wants("input/slots-per-key") &&
+        !runner.wants("input/lookups-per-key") &&
+        !runner.wants("input/keystroke"))
+    {
+        return;
+    }
+
+    MainWindow window;
+    BenchmarkAccess::setUrlText(window, "");
+    BenchmarkAccess::setUserText(window, "");
+    QCoreApplication::processEvents();
+
+    // Work done by the window per typed key
+    const int slotCalls = BenchmarkAccess::inputSlotCalls(window);
+    const int lookups   = BenchmarkAccess::inputLookups(window);
+
+    int keys = type(window, TYPED_URL, BenchmarkAccess::setUrlText);
+    keys += type(window, TYPED_USER, BenchmarkAccess::setUserText);
+
+    if (runner.wants("input/slots-per-key"))
+    {
+        runner.report("input/slots-per-key",
+            static_cast<double>(BenchmarkAccess::inputSlotCalls(window) - slotCalls) / keys,
+            "calls");
+    }
+
+    if (runner.wants("input/lookups-per-key"))
+    {
+        runner.report("input/lookups-per-key",
+            static_cast<double>(BenchmarkAccess::inputLookups(window) - lookups) / keys,
+            "lookups");
+    }
+
+    // Time of a key including the update of the window
+    const QString url(TYPED_URL);
+    runner.measure("input/keystroke", [&](int n)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            BenchmarkAccess::setUrlText(window, url.left(j % url.length() + 1));
+            QCoreApplication::processEvents();
+        }
+    });
+}
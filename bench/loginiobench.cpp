@@ -0,0 +1,154 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QHash>
+
+#include "benchmark.h"
+#include "importworker.h"
+#include "logincatalog.h"
+#include "loginio.h"
+
+BENCHMARK_GROUP(loginIOBenchmarks)
+{
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int     size     = runner.sizes().at(i);
+        const QString fileName = runner.workDir() + QString("/logins-%1.fpm").arg(size);
+
+        if (!runner.wants(QString("loginio/export/%1").arg(size)) &&
+            !runner.wants(QString("loginio/import/%1").arg(size)) &&
+            !runner.wants(QString("loginio/import-stream/%1").arg(size)) &&
+            !runner.wants(QString("import/unchanged/%1").arg(size)) &&
+            !runner.wants(QString("import/new/%1").arg(size)))
+        {
+            continue;
+        }
+
+        const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+
+        // The file is needed by the import benchmarks even if the export is filtered out
+        const auto exportLogins = [&]()
+        {
+            if (!LoginIO::exportLogins(logins, fileName))
+            {
+                runner.fail("LoginIO::exportLogins()");
+            }
+        };
+
+        const QString exportName = QString("loginio/export/%1").arg(size);
+        runner.wants(exportName) ? runner.measureOnce(exportName, exportLogins) : exportLogins();
+
+        runner.measureOnce(QString("loginio/import/%1").arg(size), [&]()
+        {
+            LoginIO::LoginList imported;
+            if (!LoginIO::importLogins(imported, fileName) || imported.count() != size)
+            {
+                runner.fail("LoginIO::importLogins()");
+            }
+        });
+
+        // Importing in the window when every login is already there or new
+        QHash<QString, LoginData> current;
+        for (int j = 0; j < logins.count(); j++)
+        {
+            current.insert(logins.at(j).url(), logins.at(j));
+        }
+
+        runner.measureOnce(QString("import/unchanged/%1").arg(size), [&]()
+        {
+            ImportWorker worker(fileName, current);
+            worker.start();
+            worker.wait();
+            if (!worker.ok() || !worker.changes().isEmpty() || worker.unchangedCount() != size)
+            {
+                runner.fail("ImportWorker with unchanged logins");
+            }
+        });
+
+        runner.measureOnce(QString("import/new/%1").arg(size), [&]()
+        {
+            ImportWorker worker(fileName, QHash<QString, LoginData>());
+            worker.start();
+            worker.wait();
+            if (!worker.ok() || worker.changes().count() != size)
+            {
+                runner.fail("ImportWorker with new logins");
+            }
+        });
+
+        // Streaming without collecting the logins, i.e. in constant memory
+        runner.measureOnce(QString("loginio/import-stream/%1").arg(size), [&]()
+        {
+            int count = 0;
+            if (!LoginIO::importLogins(fileName, [&count](const LoginData &) { count++; }) ||
+                count != size)
+            {
+                runner.fail("LoginIO::importLogins() with a callback");
+            }
+        });
+    }
+
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int     size     = runner.sizes().at(i);
+        const QString fileName = runner.workDir() + QString("/logins-%1.fpmc").arg(size);
+
+        if (!runner.wants(QString("catalog/export/%1").arg(size)) &&
+            !runner.wants(QString("catalog/open-to-first-lookup/%1").arg(size)) &&
+            !runner.wants(QString("catalog/lookup/%1").arg(size)))
+        {
+            continue;
+        }
+
+        const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+        const QString            url    = logins.at(size / 2).url();
+
+        const auto exportCatalog = [&]()
+        {
+            if (!LoginIO::exportCatalog(logins, fileName))
+            {
+                runner.fail("LoginIO::exportCatalog()");
+            }
+        };
+
+        const QString exportName = QString("catalog/export/%1").arg(size);
+        runner.wants(exportName) ? runner.measureOnce(exportName, exportCatalog) : exportCatalog();
+
+        runner.measureOnce(QString("catalog/open-to-first-lookup/%1").arg(size), [&]()
+        {
+            LoginCatalog catalog;
+            if (!catalog.open(fileName) || catalog.find(url) < 0)
+            {
+                runner.fail("LoginCatalog::find()");
+            }
+        });
+
+        LoginCatalog catalog;
+        if (!catalog.open(fileName))
+        {
+            runner.fail("LoginCatalog::open()");
+            continue;
+        }
+
+        runner.measure(QString("catalog/lookup/%1").arg(size), [&](int n)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                Benchmark::consume(catalog.find(logins.at(j % size).url()));
+            }
+        });
+    }
+}
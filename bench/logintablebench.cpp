@@ -0,0 +1,169 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include "benchmark.h"
+#include "logintable.h"
+
+namespace
+{
+    //! Number of different urls looked up.
+    const int LOOKUP_KEYS = 4096;
+
+    //! Fill the hash used by MainWindow before the login table. The list
+    //! is freed before returning, so that only the heap used by the hash
+    //! remains.
+    void fillHash(QHash<QString, LoginData> & rHash, int size)
+    {
+        const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+        rHash.reserve(size);
+        for (int i = 0; i < logins.count(); i++)
+        {
+            rHash[logins.at(i).url()] = logins.at(i);
+        }
+    }
+
+    //! Fill the login table like fillHash() does the hash.
+    void fillTable(LoginTable & rTable, int size)
+    {
+        const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+        rTable.reserve(size);
+        for (int i = 0; i < logins.count(); i++)
+        {
+            rTable.insert(logins.at(i));
+        }
+    }
+}
+
+BENCHMARK_GROUP(loginTableBenchmarks)
+{
+    const bool heapKnown = Benchmark::heapUsage() >= 0;
+
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int size = runner.sizes().at(i);
+
+        const QString hashBytes   = QString("loginhash/bytes-per-login/%1").arg(size);
+        const QString hashHit     = QString("loginhash/lookup-hit/%1").arg(size);
+        const QString hashMiss    = QString("loginhash/lookup-miss/%1").arg(size);
+        const QString tableBytes  = QString("logintable/bytes-per-login/%1").arg(size);
+        const QString tableHit    = QString("logintable/lookup-hit/%1").arg(size);
+        const QString tableMiss   = QString("logintable/lookup-miss/%1").arg(size);
+        const QString tableLatin1 = QString("logintable/lookup-latin1/%1").arg(size);
+
+        const bool wantsHash  = runner.wants(hashBytes) || runner.wants(hashHit) ||
+            runner.wants(hashMiss);
+        const bool wantsTable = runner.wants(tableBytes) || runner.wants(tableHit) ||
+            runner.wants(tableMiss) || runner.wants(tableLatin1);
+        if (!wantsHash && !wantsTable)
+        {
+            continue;
+        }
+
+        // Saved urls spread over the whole set, and urls that are not saved
+        QStringList       hits;
+        QList<QByteArray> latin1Hits;
+        QStringList       misses;
+        {
+            const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+            const int stride = qMax(1, size / LOOKUP_KEYS);
+            for (int j = 0; j < size; j += stride)
+            {
+                hits       << logins.at(j).url();
+                latin1Hits << logins.at(j).url().toLatin1();
+                misses     << "missing-" + logins.at(j).url();
+            }
+        }
+
+        const int keys = hits.count();
+
+        if (wantsHash)
+        {
+            QHash<QString, LoginData> hash;
+            const qint64 before = Benchmark::heapUsage();
+            fillHash(hash, size);
+            if (heapKnown && runner.wants(hashBytes))
+            {
+                runner.report(hashBytes,
+                    static_cast<double>(Benchmark::heapUsage() - before) / size, "bytes");
+            }
+
+            runner.measure(hashHit, [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    Benchmark::consume(hash.constFind(hits.at(j % keys)) != hash.constEnd());
+                }
+            });
+
+            runner.measure(hashMiss, [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    Benchmark::consume(hash.constFind(misses.at(j % keys)) != hash.constEnd());
+                }
+            });
+        }
+
+        if (wantsTable)
+        {
+            LoginTable table;
+            const qint64 before = Benchmark::heapUsage();
+            fillTable(table, size);
+            if (heapKnown && runner.wants(tableBytes))
+            {
+                runner.report(tableBytes,
+                    static_cast<double>(Benchmark::heapUsage() - before) / size, "bytes");
+            }
+
+            if (table.count() != size || table.find(hits.first()) < 0 ||
+                table.find(misses.first()) >= 0)
+            {
+                runner.fail("LoginTable::find()");
+            }
+
+            runner.measure(tableHit, [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    Benchmark::consume(table.find(hits.at(j % keys)));
+                }
+            });
+
+            runner.measure(tableMiss, [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    Benchmark::consume(table.find(misses.at(j % keys)));
+                }
+            });
+
+            // Looked up straight from bytes, without building a QString
+            runner.measure(tableLatin1, [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    const QByteArray & url = latin1Hits.at(j % keys);
+                    Benchmark::consume(table.findLatin1(url.constData(), url.size()));
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,234 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStringList>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "benchmark.h"
+#include "config.h"
+
+namespace
+{
+    //! Command line options.
+    struct Options
+    {
+        Options()
+        : threshold(5.0)
+        {
+            sizes << 1000 << 100000 << 1000000;
+        }
+
+        //! Login counts of the macrobenchmarks.
+        QList<int> sizes;
+
+        //! Only run benchmarks whose name contains this.
+        QString filter;
+
+        //! Write the results to this JSON file.
+        QString output;
+
+        //! Compare the results against this JSON file.
+        QString baseline;
+
+        //! Slowdown in percent that is flagged as a regression.
+        double threshold;
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: fleetingpm-bench [--sizes N,N,..] [--filter TEXT] [--output FILE]\n"
+            "                        [--baseline FILE] [--threshold PERCENT]\n"
+            "\n"
+            "  --sizes N,N,..      Login counts of the macrobenchmarks\n"
+            "                      (default 1000,100000,1000000).\n"
+            "  --filter TEXT       Only run benchmarks whose name contains TEXT.\n"
+            "  --output FILE       Write the results to FILE as JSON.\n"
+            "  --baseline FILE     Compare the results to an earlier --output.\n"
+            "  --threshold PERCENT Flag slowdowns above PERCENT (default 5).\n");
+    }
+
+    bool parseOptions(const QStringList & args, Options & rOptions)
+    {
+        for (int i = 1; i < args.count(); i++)
+        {
+            const QString & arg = args.at(i);
+            if (i + 1 >= args.count())
+            {
+                return false;
+            }
+
+            const QString value = args.at(++i);
+            bool ok = true;
+            if (arg == "--sizes")
+            {
+                rOptions.sizes.clear();
+                const QStringList sizes = value.split(',');
+                for (int j = 0; j < sizes.count() && ok; j++)
+                {
+                    rOptions.sizes << sizes.at(j).toInt(&ok);
+                }
+            }
+            else if (arg == "--filter")
+            {
+                rOptions.filter = value;
+            }
+            else if (arg == "--output")
+            {
+                rOptions.output = value;
+            }
+            else if (arg == "--baseline")
+            {
+                rOptions.baseline = value;
+            }
+            else if (arg == "--threshold")
+            {
+                rOptions.threshold = value.toDouble(&ok);
+            }
+            else
+            {
+                return false;
+            }
+
+            if (!ok)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //! Compare results to the baseline and return the number of regressions.
+    int compare(const QList<Benchmark::Result> & results,
+        const QList<Benchmark::Result> & baseline, double threshold)
+    {
+        std::printf("\n%-48s %10s %10s %8s\n", "Comparison to baseline", "baseline", "current", "delta");
+
+        int regressions = 0;
+        for (int i = 0; i < results.count(); i++)
+        {
+            for (int j = 0; j < baseline.count(); j++)
+            {
+                if (baseline.at(j).name != results.at(i).name || baseline.at(j).value <= 0)
+                {
+                    continue;
+                }
+
+                const double delta = (results.at(i).value - baseline.at(j).value) /
+                    baseline.at(j).value * 100.0;
+                const bool regression = delta > threshold;
+                regressions += regression;
+
+                std::printf("%-48s %10.2f %10.2f %+7.1f%%%s\n",
+                    results.at(i).name.toLocal8Bit().constData(),
+                    baseline.at(j).value, results.at(i).value, delta,
+                    regression ? "  REGRESSION" : "");
+                break;
+            }
+        }
+
+        return regressions;
+    }
+
+    //! Remove the directory and everything in it.
+    void removeDir(const QString & path)
+    {
+        QDirIterator it(path, QDir::Files | QDir::Dirs | QDir::Hidden | QDir::NoDotAndDotDot);
+        while (it.hasNext())
+        {
+            it.next();
+            if (it.fileInfo().isDir())
+            {
+                removeDir(it.filePath());
+            }
+            else
+            {
+                QFile::remove(it.filePath());
+            }
+        }
+
+        QDir().rmdir(path);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+#ifdef USE_QT5
+    // The settings benchmarks create windows but never show them
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+#endif
+
+    QApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app.arguments(), options))
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    // Keep the user's settings and logins out of reach of the benchmarks.
+    // The paths only move files, the native settings are in the registry on
+    // Windows and in a plist on macOS, so the bench also uses names of its own.
+    const QString name = QString("fleetingpm-bench-%1").arg(QCoreApplication::applicationPid());
+    const QString workDir = QDir::tempPath() + "/" + name;
+    QDir().mkpath(workDir);
+    QSettings::setPath(QSettings::NativeFormat, QSettings::UserScope, workDir);
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, workDir);
+
+    const QByteArray settingsName = name.toLatin1();
+    Config::COMPANY  = settingsName.constData();
+    Config::SOFTWARE = settingsName.constData();
+
+    Benchmark::Runner runner(options.sizes, options.filter, workDir);
+    runner.run();
+
+    QSettings(Config::COMPANY, Config::SOFTWARE).clear();
+    removeDir(workDir);
+
+    if (!options.output.isEmpty() && !Benchmark::writeJson(runner.results(), options.output))
+    {
+        std::fprintf(stderr, "Cannot write '%s'.\n", options.output.toLocal8Bit().constData());
+        return EXIT_FAILURE;
+    }
+
+    int regressions = 0;
+    if (!options.baseline.isEmpty())
+    {
+        QList<Benchmark::Result> baseline;
+        if (!Benchmark::readJson(options.baseline, baseline))
+        {
+            std::fprintf(stderr, "Cannot read '%s'.\n", options.baseline.toLocal8Bit().constData());
+            return EXIT_FAILURE;
+        }
+
+        regressions = compare(runner.results(), baseline, options.threshold);
+    }
+
+    return runner.failed() || regressions ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QDir>
+#include <QFile>
+#include <QStringList>
+
+#include "benchmark.h"
+#include "benchmarkaccess.h"
+#include "loginstore.h"
+#include "storeworker.h"
+
+namespace
+{
+    //! Remove the files of a directory.
+    void clearDirectory(const QString & path)
+    {
+        const QStringList names = QDir(path).entryList(QDir::Files);
+        for (int i = 0; i < names.count(); i++)
+        {
+            QFile::remove(path + "/" + names.at(i));
+        }
+    }
+}
+
+BENCHMARK_GROUP(settingsBenchmarks)
+{
+    // The window reads the default store, which main() moved under the work directory
+    const QString directory = LoginStore::defaultDirectory();
+
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int size = runner.sizes().at(i);
+        if (!runner.wants(QString("loginstore/save-all/%1").arg(size)) &&
+            !runner.wants(QString("loginstore/load/%1").arg(size)) &&
+            !runner.wants(QString("loginstore/save-one/%1").arg(size)) &&
+            !runner.wants(QString("storeworker/save-one/%1").arg(size)) &&
+            !runner.wants(QString("settings/load/%1").arg(size)))
+        {
+            continue;
+        }
+
+        const LoginIO::LoginList logins = Benchmark::makeLogins(size);
+
+        clearDirectory(directory);
+        {
+            LoginStore store(directory);
+            LoginIO::LoginList loaded;
+            if (!store.load(loaded))
+            {
+                runner.fail("LoginStore::load()");
+                continue;
+            }
+
+            // Stored as an import would do, the compaction runs in the background
+            const auto saveAll = [&]()
+            {
+                if (!store.save(logins))
+                {
+                    runner.fail("LoginStore::save()");
+                }
+            };
+
+            const QString saveAllName = QString("loginstore/save-all/%1").arg(size);
+            runner.wants(saveAllName) ? runner.measureOnce(saveAllName, saveAll) : saveAll();
+        }
+
+        // Only one store may use the directory at a time
+        {
+            LoginStore store(directory);
+            const auto load = [&]()
+            {
+                LoginIO::LoginList loaded;
+                if (!store.load(loaded) || loaded.count() != size)
+                {
+                    runner.fail("LoginStore::load()");
+                }
+            };
+
+            const QString loadName = QString("loginstore/load/%1").arg(size);
+            runner.wants(loadName) ? runner.measureOnce(loadName, load) : load();
+
+            // A single durable change, like saving the login of the window
+            runner.measure(QString("loginstore/save-one/%1").arg(size), [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    if (!store.save(logins.at(j % size)))
+                    {
+                        runner.fail("LoginStore::save()");
+                        return;
+                    }
+                }
+            });
+
+            // The same through the worker, which is what the window waits for
+            StoreWorker worker(store);
+            runner.measure(QString("storeworker/save-one/%1").arg(size), [&](int n)
+            {
+                for (int j = 0; j < n; j++)
+                {
+                    worker.save(logins.at(j % size));
+                }
+            });
+
+            if (!worker.flush())
+            {
+                runner.fail("StoreWorker::flush()");
+            }
+        }
+
+        MainWindow window;
+        runner.measureOnce(QString("settings/load/%1").arg(size), [&]()
+        {
+            BenchmarkAccess::loadSettings(window);
+        });
+
+        if (BenchmarkAccess::loginCount(window) != size)
+        {
+            runner.fail("MainWindow::loadSettings()");
+        }
+    }
+}
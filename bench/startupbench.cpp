@@ -0,0 +1,91 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QStringList>
+
+#include "benchmark.h"
+#include "benchmarkaccess.h"
+#include "loginstore.h"
+
+namespace
+{
+    //! Remove the files of a directory.
+    void clearDirectory(const QString & path)
+    {
+        const QStringList names = QDir(path).entryList(QDir::Files);
+        for (int i = 0; i < names.count(); i++)
+        {
+            QFile::remove(path + "/" + names.at(i));
+        }
+    }
+
+    //! Time from creating the window to its first paint.
+    void measureFirstPaint(Benchmark::Runner & runner, const QString & name, int size)
+    {
+        QScopedPointer<MainWindow> window;
+        const auto open = [&]()
+        {
+            window.reset(new MainWindow);
+            window->show();
+            QApplication::processEvents();
+        };
+
+        runner.wants(name) ? runner.measureOnce(name, open) : open();
+
+        if (BenchmarkAccess::loginCount(*window) != size)
+        {
+            runner.fail("MainWindow::loadSettings()");
+        }
+
+        // Closing writes the startup cache
+        window->close();
+    }
+}
+
+BENCHMARK_GROUP(startupBenchmarks)
+{
+    const QString directory = LoginStore::defaultDirectory();
+
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int     size    = runner.sizes().at(i);
+        const QString noCache = QString("startup/first-paint-store/%1").arg(size);
+        const QString cached  = QString("startup/first-paint-cached/%1").arg(size);
+        if (!runner.wants(noCache) && !runner.wants(cached))
+        {
+            continue;
+        }
+
+        clearDirectory(directory);
+        {
+            LoginStore store(directory);
+            LoginIO::LoginList loaded;
+            if (!store.load(loaded) || !store.save(Benchmark::makeLogins(size)))
+            {
+                runner.fail("LoginStore::save()");
+                continue;
+            }
+        }
+
+        // The first start loads the store, the next one the cache
+        measureFirstPaint(runner, noCache, size);
+        measureFirstPaint(runner, cached, size);
+    }
+}
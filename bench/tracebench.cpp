@@ -0,0 +1,56 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QDir>
+#include <QFile>
+
+#include "benchmark.h"
+#include "trace.h"
+
+BENCHMARK_GROUP(traceBenchmarks)
+{
+    // The spans left in the hot paths when not tracing
+    runner.measure("trace/disabled-span", [&](int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            TRACE_SPAN("disabled");
+        }
+    });
+
+    if (!runner.wants("trace/enabled-span"))
+    {
+        return;
+    }
+
+    // The recording itself, without writing the file. Spans past the
+    // limit of a trace are dropped, so a long run measures some of those too.
+    Trace::start(QDir::tempPath() + "/fleetingpm-bench-trace.json");
+    runner.measure("trace/enabled-span", [&](int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            TRACE_SPAN("enabled");
+        }
+    });
+
+    if (!Trace::finish())
+    {
+        runner.fail("Trace::finish()");
+    }
+
+    QFile::remove(QDir::tempPath() + "/fleetingpm-bench-trace.json");
+}
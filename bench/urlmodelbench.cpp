@@ -0,0 +1,152 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QComboBox>
+#include <QListView>
+#include <QStringList>
+
+#include "benchmark.h"
+#include "urlcompleter.h"
+#include "urllistmodel.h"
+
+namespace
+{
+    //! The old combo box is only measured up to this size, it's too slow beyond.
+    const int MAX_PLAIN_COMBO_SIZE = 100000;
+
+    QStringList makeUrls(int count)
+    {
+        const LoginIO::LoginList logins = Benchmark::makeLogins(count);
+
+        QStringList urls;
+        urls.reserve(count);
+        for (int i = 0; i < logins.count(); i++)
+        {
+            urls << logins.at(i).url();
+        }
+
+        return urls;
+    }
+
+    //! Set up the combo box like MainWindow does.
+    void initCombo(QComboBox & combo, UrlListModel & model)
+    {
+        combo.setEditable(true);
+        QListView * view = new QListView(&combo);
+        view->setUniformItemSizes(true);
+        combo.setView(view);
+        combo.setModel(&model);
+        combo.setInsertPolicy(QComboBox::NoInsert);
+        combo.setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLength);
+    }
+}
+
+BENCHMARK_GROUP(urlModelBenchmarks)
+{
+    for (int i = 0; i < runner.sizes().count(); i++)
+    {
+        const int size = runner.sizes().at(i);
+        if (!runner.wants(QString("urlmodel/startup/%1").arg(size)) &&
+            !runner.wants(QString("urlmodel/add-remove/%1").arg(size)) &&
+            !runner.wants(QString("urlmodel/find/%1").arg(size)) &&
+            !runner.wants(QString("urlmodel/complete/%1").arg(size)) &&
+            !runner.wants(QString("combo/startup/%1").arg(size)) &&
+            !runner.wants(QString("combo/add-remove/%1").arg(size)))
+        {
+            continue;
+        }
+
+        const QStringList urls = makeUrls(size);
+
+        // Filling the combo box when the window starts
+        QComboBox    combo;
+        UrlListModel model;
+        runner.measureOnce(QString("urlmodel/startup/%1").arg(size), [&]()
+        {
+            initCombo(combo, model);
+            model.setUrls(urls);
+        });
+
+        if (model.rowCount() != size)
+        {
+            initCombo(combo, model);
+            model.setUrls(urls);
+        }
+
+        // Saving and removing a login
+        runner.measure(QString("urlmodel/add-remove/%1").arg(size), [&](int n)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                const QString url = QString("new-%1.example.com").arg(j);
+                model.add(url);
+                model.remove(url);
+            }
+        });
+
+        runner.measure(QString("urlmodel/find/%1").arg(size), [&](int n)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                Benchmark::consume(model.find(urls.at(j % size)));
+            }
+        });
+
+        // Completions for a typed prefix of a few characters
+        runner.measure(QString("urlmodel/complete/%1").arg(size), [&](int n)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                const QString & url = urls.at(j % size);
+                Benchmark::consume(model.completions(url.left(2 + j % 5),
+                    UrlCompleter::MAX_COMPLETIONS).count());
+            }
+        });
+
+        if (size > MAX_PLAIN_COMBO_SIZE)
+        {
+            continue;
+        }
+
+        // The same with a plain combo box as before
+        QComboBox plain;
+        plain.setEditable(true);
+        runner.measureOnce(QString("combo/startup/%1").arg(size), [&]()
+        {
+            for (int j = 0; j < urls.count(); j++)
+            {
+                plain.addItem(urls.at(j));
+            }
+
+            plain.model()->sort(0);
+        });
+
+        runner.measure(QString("combo/add-remove/%1").arg(size), [&](int n)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                const QString url = QString("new-%1.example.com").arg(j);
+                if (plain.findText(url) == -1)
+                {
+                    plain.addItem(url);
+                    plain.model()->sort(0);
+                }
+
+                plain.removeItem(plain.findText(url));
+            }
+        });
+    }
+}
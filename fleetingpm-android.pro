@@ -3,6 +3,7 @@ TARGET      = fleetingpm
 DEPENDPATH  += . src data/doc data/icons data/images
 INCLUDEPATH += . src
 QT          += widgets xml
+CONFIG      += c++11
 DEFINES     += UseQt5=ON PROGRAM_VERSION=\\\"2.8.8-android\\\"
 
 # Check Qt version
@@ -13,23 +14,57 @@ error("Use at least Qt 5.1.")
 
 # Input
 HEADERS += src/aboutdlg.h \
+           src/backgroundrenderer.h \
            src/config.h \
+           src/encoder.h \
            src/engine.h \
+           src/fadinglineedit.h \
+           src/generator.h \
+           src/importworker.h \
            src/instructionsdlg.h \
+           src/kdf.h \
+           src/logincatalog.h \
            src/logindata.h \
            src/loginio.h \
+           src/loginstore.h \
+           src/logintable.h \
            src/mainwindow.h \
-           src/settingsdlg.h
+           src/md5.h \
+           src/settingsdlg.h \
+           src/sha256.h \
+           src/startupcache.h \
+           src/storeworker.h \
+           src/trace.h \
+           src/urlcompleter.h \
+           src/urlindex.h \
+           src/urllistmodel.h
            
 SOURCES += src/aboutdlg.cpp \
+           src/backgroundrenderer.cpp \
            src/config.cpp \
+           src/encoder.cpp \
            src/engine.cpp \
+           src/fadinglineedit.cpp \
+           src/generator.cpp \
+           src/importworker.cpp \
            src/instructionsdlg.cpp \
+           src/kdf.cpp \
+           src/logincatalog.cpp \
            src/logindata.cpp \
            src/loginio.cpp \
+           src/loginstore.cpp \
+           src/logintable.cpp \
            src/main.cpp \
            src/mainwindow.cpp \
-           src/settingsdlg.cpp
+           src/md5.cpp \
+           src/settingsdlg.cpp \
+           src/sha256.cpp \
+           src/startupcache.cpp \
+           src/storeworker.cpp \
+           src/trace.cpp \
+           src/urlcompleter.cpp \
+           src/urlindex.cpp \
+           src/urllistmodel.cpp
            
 RESOURCES += data/doc/Instructions.qrc \
              data/icons/Icons.qrc \
@@ -0,0 +1,104 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "backgroundrenderer.h"
+
+#include <QPainter>
+#include <QRect>
+#include <QRectF>
+#include <QWidget>
+
+#include <cmath>
+
+namespace
+{
+    //! Granularity of the cache size. Resizing the window renders
+    //! the cache again only when crossing a step.
+    const int SIZE_STEP = 256;
+
+    int roundUp(int value)
+    {
+        return (value + SIZE_STEP - 1) / SIZE_STEP * SIZE_STEP;
+    }
+}
+
+BackgroundRenderer::BackgroundRenderer(const QString & imageName)
+: m_imageName(imageName)
+, m_ratio(0)
+, m_renderCount(0)
+{
+}
+
+void BackgroundRenderer::paint(QWidget & widget, const QRect & rect)
+{
+#if QT_VERSION >= 0x050100
+    const qreal ratio = widget.devicePixelRatio();
+#else
+    const qreal ratio = 1;
+#endif
+
+    const QSize size = widget.size();
+    if (ratio != m_ratio || size.width() > m_size.width() || size.height() > m_size.height())
+    {
+        render(widget, size, ratio);
+    }
+
+    // The source rect is in the device pixels of the cache
+    const QRectF source(rect.x() * ratio, rect.y() * ratio,
+        rect.width() * ratio, rect.height() * ratio);
+
+    QPainter painter(&widget);
+    painter.drawPixmap(QRectF(rect), m_cache, source);
+}
+
+int BackgroundRenderer::renderCount() const
+{
+    return m_renderCount;
+}
+
+void BackgroundRenderer::render(const QWidget & widget, const QSize & size, qreal ratio)
+{
+    if (m_image.isNull())
+    {
+        m_image.load(m_imageName);
+    }
+
+    // Keep the covered size when only the ratio changed
+    m_size  = QSize(roundUp(qMax(size.width(),  m_size.width())),
+        roundUp(qMax(size.height(), m_size.height())));
+    m_ratio = ratio;
+
+    m_cache = QPixmap(static_cast<int>(std::ceil(m_size.width()  * ratio)),
+        static_cast<int>(std::ceil(m_size.height() * ratio)));
+
+    // Scale the tile once, so that the tiling is a plain copy
+    QPixmap tile = m_image;
+    if (ratio != 1 && !tile.isNull())
+    {
+        tile = m_image.scaled(m_image.size() * ratio, Qt::IgnoreAspectRatio,
+            Qt::SmoothTransformation);
+    }
+
+    // The window color shows through the translucent parts of the image
+    QPainter painter(&m_cache);
+    painter.fillRect(m_cache.rect(), widget.palette().window());
+    if (!tile.isNull())
+    {
+        painter.drawTiledPixmap(m_cache.rect(), tile);
+    }
+
+    m_renderCount++;
+}
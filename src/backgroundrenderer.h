@@ -0,0 +1,71 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef BACKGROUNDRENDERER_H
+#define BACKGROUNDRENDERER_H
+
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+class QRect;
+class QWidget;
+
+//! Paints a tiled background image from a cached pixmap rendered
+//! for the device pixel ratio of the widget. A repaint copies the
+//! exposed part of the cache, and the cache is only rendered again
+//! when the widget grows past it or moves to a screen with a
+//! different device pixel ratio.
+//!
+//! The tiles are anchored to the top left corner like those of a
+//! style sheet background-image, so a cache bigger than the widget
+//! stays valid and a shrinking widget never renders it again.
+class BackgroundRenderer
+{
+public:
+
+    //! Constructor. The image is loaded when first painted.
+    explicit BackgroundRenderer(const QString & imageName);
+
+    //! Paint the given rect of the widget. Call from paintEvent().
+    void paint(QWidget & widget, const QRect & rect);
+
+    //! Return the number of times the cache has been rendered.
+    int renderCount() const;
+
+private:
+
+    //! Render the cache to cover at least the given size.
+    void render(const QWidget & widget, const QSize & size, qreal ratio);
+
+    QString m_imageName;
+
+    //! The unscaled image.
+    QPixmap m_image;
+
+    //! The tiled image in device pixels.
+    QPixmap m_cache;
+
+    //! Size covered by m_cache in widget coordinates.
+    QSize m_size;
+
+    //! Device pixel ratio m_cache was rendered for.
+    qreal m_ratio;
+
+    int m_renderCount;
+};
+
+#endif // BACKGROUNDRENDERER_H
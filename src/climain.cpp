@@ -0,0 +1,350 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "daemon.h"
+#include "engine.h"
+#include "loginio.h"
+
+namespace
+{
+    //! Number of logins generated at a time. Bounds the memory use
+    //! regardless of the size of the input.
+    const int BATCH_SIZE = 4096;
+
+    //! Command line options.
+    struct Options
+    {
+        Options()
+        : masterFd(-1)
+        , masterDelay(5)
+        , length(8)
+        , fileName("-")
+        {}
+
+        //! File descriptor to read the master password from.
+        int masterFd;
+
+        //! Minutes the daemon keeps the master password.
+        int masterDelay;
+
+        //! Local socket of the daemon, empty if not running as one.
+        QString daemonName;
+
+        //! Password length used when the input doesn't tell it.
+        int length;
+
+        //! Input file, "-" for stdin.
+        QString fileName;
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: fleetingpm-cli --master-fd FD [--length N] [FILE]\n"
+            "       fleetingpm-cli --daemon SOCKET [--master-fd FD] [--master-delay MINS]\n"
+            "\n"
+            "Generate passwords for the logins read from FILE or stdin and\n"
+            "write them to stdout as URL<TAB>USER<TAB>PASSWORD lines.\n"
+            "\n"
+            "FILE is either an exported .fpm file or text with one\n"
+            "URL<TAB>USER[<TAB>LENGTH] record per line.\n"
+            "\n"
+            "With --daemon, serve generate requests on the local socket SOCKET\n"
+            "instead. See src/protocol.h for the protocol.\n"
+            "\n"
+            "  --master-fd FD      Read the master password from file descriptor FD.\n"
+            "  --length N          Password length for records without one (default 8).\n"
+            "  --daemon SOCKET     Run as a daemon listening to SOCKET.\n"
+            "  --master-delay MINS Forget the master password after MINS minutes\n"
+            "                      in daemon mode (default 5).\n");
+    }
+
+    bool parseOptions(int argc, char ** argv, Options & rOptions)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const QString arg = QString::fromLocal8Bit(argv[i]);
+            if (arg == "--daemon" && i + 1 < argc)
+            {
+                rOptions.daemonName = QString::fromLocal8Bit(argv[++i]);
+            }
+            else if ((arg == "--master-fd" || arg == "--length" || arg == "--master-delay") &&
+                i + 1 < argc)
+            {
+                bool ok = false;
+                const int value = QString::fromLocal8Bit(argv[++i]).toInt(&ok);
+                if (!ok || value < 0)
+                {
+                    return false;
+                }
+
+                if (arg == "--master-fd")
+                {
+                    rOptions.masterFd = value;
+                }
+                else if (arg == "--length")
+                {
+                    rOptions.length = value;
+                }
+                else
+                {
+                    rOptions.masterDelay = value;
+                }
+            }
+            else if (arg.startsWith("--") || rOptions.fileName != "-")
+            {
+                return false;
+            }
+            else
+            {
+                rOptions.fileName = arg;
+            }
+        }
+
+        if (!rOptions.daemonName.isEmpty())
+        {
+            return rOptions.fileName == "-" && rOptions.masterDelay > 0;
+        }
+
+        return rOptions.masterFd >= 0 && rOptions.length > 0;
+    }
+
+    //! Read the first line of the given file descriptor.
+    bool readMaster(int fd, QString & rMaster)
+    {
+        QFile file;
+        if (!file.open(fd, QIODevice::ReadOnly))
+        {
+            return false;
+        }
+
+        QByteArray line = file.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+
+        rMaster = QString::fromUtf8(line.constData(), line.size());
+
+        // Don't leave a copy of the master password lying around
+        line.fill('\0');
+        return !rMaster.isEmpty();
+    }
+
+    //! Generates passwords batch by batch and writes them to stdout.
+    //! The master password is prepared once for all batches.
+    class BatchWriter
+    {
+    public:
+
+        explicit BatchWriter(const QString & master)
+        : m_master(master)
+        {
+            m_logins.reserve(BATCH_SIZE);
+        }
+
+        void add(const LoginData & login)
+        {
+            m_logins << login;
+            if (m_logins.count() == BATCH_SIZE)
+            {
+                flush();
+            }
+        }
+
+        void flush()
+        {
+            Engine::generateBatch(m_master, m_logins, m_passwords);
+
+            for (int i = 0; i < m_logins.count(); i++)
+            {
+                m_out  = m_logins.at(i).url().toUtf8();
+                m_out += '\t';
+                m_out += m_logins.at(i).userName().toUtf8();
+                m_out += '\t';
+                m_out += m_passwords.at(i).toLatin1();
+                m_out += '\n';
+                std::fwrite(m_out.constData(), 1, m_out.size(), stdout);
+            }
+
+            m_logins.clear();
+        }
+
+    private:
+
+        const Engine::Master m_master;
+
+        LoginIO::LoginList m_logins;
+
+        QVector<QString> m_passwords;
+
+        QByteArray m_out;
+    };
+
+    //! Stream URL<TAB>USER[<TAB>LENGTH] lines.
+    bool readText(QIODevice & in, int defaultLength, BatchWriter & writer)
+    {
+        while (!in.atEnd())
+        {
+            QByteArray line = in.readLine();
+            while (line.endsWith('\n') || line.endsWith('\r'))
+            {
+                line.chop(1);
+            }
+
+            if (line.isEmpty())
+            {
+                continue;
+            }
+
+            const QList<QByteArray> fields = line.split('\t');
+            if (fields.count() < 2 || fields.count() > 3)
+            {
+                std::fprintf(stderr, "Invalid record: %s\n", line.constData());
+                return false;
+            }
+
+            int length = defaultLength;
+            if (fields.count() == 3)
+            {
+                bool ok = false;
+                length = fields.at(2).toInt(&ok);
+                if (!ok || length <= 0)
+                {
+                    std::fprintf(stderr, "Invalid length: %s\n", line.constData());
+                    return false;
+                }
+            }
+
+            writer.add(LoginData(QString::fromUtf8(fields.at(0)),
+                QString::fromUtf8(fields.at(1)), length));
+        }
+
+        return true;
+    }
+
+    //! Stream the logins of a .fpm file.
+    bool readFpm(QIODevice & in, int defaultLength, BatchWriter & writer)
+    {
+        LoginIO::LoginReader reader(&in);
+        LoginData login;
+        while (reader.readNext(login))
+        {
+            if (login.passwordLength() <= 0)
+            {
+                login.setPasswordLength(defaultLength);
+            }
+
+            writer.add(login);
+        }
+
+        if (reader.hasError())
+        {
+            std::fprintf(stderr, "Invalid .fpm file: %s\n",
+                reader.errorString().toLocal8Bit().constData());
+            return false;
+        }
+
+        return true;
+    }
+
+    int runDaemon(int argc, char ** argv, const Options & options)
+    {
+        QCoreApplication app(argc, argv);
+
+        Daemon daemon(options.masterDelay);
+        if (options.masterFd >= 0)
+        {
+            QString master;
+            if (!readMaster(options.masterFd, master))
+            {
+                std::fprintf(stderr, "Cannot read the master password from fd %d.\n",
+                    options.masterFd);
+                return EXIT_FAILURE;
+            }
+
+            daemon.setMaster(master);
+        }
+
+        if (!daemon.listen(options.daemonName))
+        {
+            std::fprintf(stderr, "Cannot listen to '%s'. Is another daemon running?\n",
+                options.daemonName.toLocal8Bit().constData());
+            return EXIT_FAILURE;
+        }
+
+        return app.exec();
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (!options.daemonName.isEmpty())
+    {
+        return runDaemon(argc, argv, options);
+    }
+
+    QString master;
+    if (!readMaster(options.masterFd, master))
+    {
+        std::fprintf(stderr, "Cannot read the master password from fd %d.\n", options.masterFd);
+        return EXIT_FAILURE;
+    }
+
+    QFile in;
+    if (options.fileName == "-")
+    {
+        in.open(stdin, QIODevice::ReadOnly);
+    }
+    else
+    {
+        in.setFileName(options.fileName);
+        if (!in.open(QIODevice::ReadOnly))
+        {
+            std::fprintf(stderr, "Cannot open '%s'.\n", options.fileName.toLocal8Bit().constData());
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Large output buffer, the results are written one line at a time
+    static char outBuffer[1 << 16];
+    std::setvbuf(stdout, outBuffer, _IOFBF, sizeof(outBuffer));
+
+    BatchWriter writer(master);
+    const bool ok = options.fileName.endsWith(".fpm") ?
+        readFpm(in, options.length, writer) :
+        readText(in, options.length, writer);
+    writer.flush();
+
+    std::fflush(stdout);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,282 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "daemon.h"
+#include "protocol.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+#include <QtEndian>
+
+#if !defined(USE_QT5) && !defined(Q_OS_WIN)
+#include <sys/stat.h>
+#endif
+
+Daemon::Daemon(int masterDelay, QObject * parent)
+: QObject(parent)
+, m_server(new QLocalServer(this))
+, m_masterTimer(new QTimer(this))
+, m_batchTimer(new QTimer(this))
+{
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(acceptConnections()));
+
+    // Initialize the timer used to forget the master password.
+    m_masterTimer->setInterval(masterDelay * 60 * 1000);
+    m_masterTimer->setSingleShot(true);
+    connect(m_masterTimer, SIGNAL(timeout()), this, SLOT(lock()));
+
+    // Requests arriving during the same event loop turn are
+    // generated together when the loop gets idle.
+    m_batchTimer->setInterval(0);
+    m_batchTimer->setSingleShot(true);
+    connect(m_batchTimer, SIGNAL(timeout()), this, SLOT(processPending()));
+}
+
+bool Daemon::listen(const QString & name)
+{
+    // Don't take the socket over from a running daemon
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(1000))
+    {
+        return false;
+    }
+
+    // Remove a stale socket left by a crashed instance
+    QLocalServer::removeServer(name);
+
+#ifdef USE_QT5
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    return m_server->listen(name);
+#elif defined(Q_OS_WIN)
+    // Qt4 can't restrict the pipe to the current user
+    return false;
+#else
+    // Qt4 has no socket options, create the socket for the user only
+    const mode_t mask = umask(077);
+    const bool ok = m_server->listen(name);
+    umask(mask);
+    return ok;
+#endif
+}
+
+void Daemon::setMaster(const QString & master)
+{
+    m_master.reset(master.isEmpty() ? 0 : new Engine::Master(master));
+    m_masterTimer->start();
+}
+
+void Daemon::acceptConnections()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QLocalSocket * client = m_server->nextPendingConnection();
+        connect(client, SIGNAL(readyRead()), this, SLOT(readRequests()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(removeClient()));
+        m_input.insert(client, QByteArray());
+    }
+}
+
+void Daemon::readRequests()
+{
+    QLocalSocket * client = qobject_cast<QLocalSocket *>(sender());
+    if (!client || !m_input.contains(client))
+    {
+        return;
+    }
+
+    QByteArray input = m_input.value(client) + client->readAll();
+
+    // Dispatch all complete frames
+    int pos = 0;
+    while (input.size() - pos >= Protocol::HEADER_SIZE)
+    {
+        const quint32 size = qFromBigEndian<quint32>(
+            reinterpret_cast<const uchar *>(input.constData() + pos));
+        if (size > Protocol::MAX_PAYLOAD_SIZE)
+        {
+            client->abort();
+            return;
+        }
+
+        if (static_cast<quint32>(input.size() - pos - Protocol::HEADER_SIZE) < size)
+        {
+            break;
+        }
+
+        if (!handleRequest(client, input.mid(pos + Protocol::HEADER_SIZE, size)))
+        {
+            client->abort();
+            return;
+        }
+
+        pos += Protocol::HEADER_SIZE + size;
+    }
+
+    if (m_input.contains(client))
+    {
+        m_input[client] = input.mid(pos);
+    }
+}
+
+bool Daemon::handleRequest(QLocalSocket * client, const QByteArray & payload)
+{
+    if (payload.size() < Protocol::PAYLOAD_HEADER_SIZE)
+    {
+        return false;
+    }
+
+    const uchar * data = reinterpret_cast<const uchar *>(payload.constData());
+    const quint8  type = data[0];
+    const quint32 id   = qFromBigEndian<quint32>(data + 1);
+
+    data += Protocol::PAYLOAD_HEADER_SIZE;
+    const int size = payload.size() - Protocol::PAYLOAD_HEADER_SIZE;
+
+    switch (type)
+    {
+    case Protocol::GENERATE:
+    {
+        if (size < 3)
+        {
+            return false;
+        }
+
+        const int length  = data[0];
+        const int urlSize = qFromBigEndian<quint16>(data + 1);
+        if (size < 5 + urlSize)
+        {
+            return false;
+        }
+
+        const int userSize = qFromBigEndian<quint16>(data + 3 + urlSize);
+        if (size != 5 + urlSize + userSize)
+        {
+            return false;
+        }
+
+        if (!m_master)
+        {
+            respond(client, Protocol::LOCKED, id);
+            return true;
+        }
+
+        Request request;
+        request.client = client;
+        request.id     = id;
+        m_pending << request;
+
+        m_pendingLogins << LoginData(
+            QString::fromUtf8(reinterpret_cast<const char *>(data + 3), urlSize),
+            QString::fromUtf8(reinterpret_cast<const char *>(data + 5 + urlSize), userSize),
+            length);
+
+        if (!m_batchTimer->isActive())
+        {
+            m_batchTimer->start();
+        }
+
+        return true;
+    }
+
+    case Protocol::UNLOCK:
+
+        // Requests queued before this one still use the old master password
+        processPending();
+        setMaster(QString::fromUtf8(reinterpret_cast<const char *>(data), size));
+        respond(client, Protocol::OK, id);
+        return true;
+
+    case Protocol::LOCK:
+
+        lock();
+        respond(client, Protocol::OK, id);
+        return true;
+
+    default:
+
+        respond(client, Protocol::BAD_REQUEST, id);
+        return true;
+    }
+}
+
+void Daemon::processPending()
+{
+    m_batchTimer->stop();
+
+    if (m_pending.isEmpty())
+    {
+        return;
+    }
+
+    Engine::generateBatch(*m_master, m_pendingLogins, m_passwords);
+
+    for (int i = 0; i < m_pending.count(); i++)
+    {
+        // The client may have disconnected while waiting
+        QLocalSocket * client = m_pending.at(i).client;
+        if (client)
+        {
+            const QByteArray password = m_passwords.at(i).toLatin1();
+            respond(client, Protocol::OK, m_pending.at(i).id,
+                password.constData(), password.size());
+        }
+    }
+
+    m_pending.clear();
+    m_pendingLogins.clear();
+    m_passwords.clear();
+}
+
+void Daemon::respond(QLocalSocket * client, quint8 status, quint32 id,
+    const char * data, int size)
+{
+    uchar header[Protocol::HEADER_SIZE + Protocol::PAYLOAD_HEADER_SIZE];
+    qToBigEndian<quint32>(Protocol::PAYLOAD_HEADER_SIZE + size, header);
+    header[Protocol::HEADER_SIZE] = status;
+    qToBigEndian<quint32>(id, header + Protocol::HEADER_SIZE + 1);
+
+    client->write(reinterpret_cast<const char *>(header), sizeof(header));
+    if (size > 0)
+    {
+        client->write(data, size);
+    }
+}
+
+void Daemon::removeClient()
+{
+    QLocalSocket * client = qobject_cast<QLocalSocket *>(sender());
+    if (client)
+    {
+        m_input.remove(client);
+        client->deleteLater();
+    }
+}
+
+void Daemon::lock()
+{
+    // Serve the requests accepted before locking
+    processPending();
+
+    m_master.reset();
+    m_masterTimer->stop();
+}
+
+Daemon::~Daemon()
+{
+    lock();
+}
@@ -0,0 +1,117 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QLocalSocket>
+#include <QObject>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+#include "engine.h"
+#include "loginio.h"
+
+class QLocalServer;
+class QTimer;
+
+//! Resident password generator serving the requests of Protocol
+//! over a local socket. The master password is kept in memory for
+//! a limited time, after which GENERATE requests fail until the
+//! daemon is unlocked again.
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    //! Constructor. The master password is forgotten after
+    //! masterDelay minutes.
+    explicit Daemon(int masterDelay, QObject * parent = 0);
+
+    //! Destructor.
+    ~Daemon();
+
+    //! Start listening to the given local socket, accessible to the
+    //! current user only. Fails if another daemon is listening to it.
+    //! Qt4 on Windows can't restrict the access, so it always fails there.
+    bool listen(const QString & name);
+
+    //! Set the master password and restart its timeout.
+    void setMaster(const QString & master);
+
+private slots:
+
+    //! Accept pending client connections.
+    void acceptConnections();
+
+    //! Read and dispatch the complete requests of the sending client.
+    void readRequests();
+
+    //! Forget a disconnected client.
+    void removeClient();
+
+    //! Generate all queued passwords as one batch and send the responses.
+    void processPending();
+
+    //! Forget the master password.
+    void lock();
+
+private:
+
+    //! Handle a single request payload. Return false if the
+    //! client broke the protocol.
+    bool handleRequest(QLocalSocket * client, const QByteArray & payload);
+
+    //! Append a response frame to the client's output.
+    void respond(QLocalSocket * client, quint8 status, quint32 id,
+        const char * data = 0, int size = 0);
+
+    //! A queued GENERATE request.
+    struct Request
+    {
+        QPointer<QLocalSocket> client;
+        quint32 id;
+    };
+
+    //! Server for the local socket.
+    QLocalServer * m_server;
+
+    //! Timer used to forget the master password.
+    QTimer * m_masterTimer;
+
+    //! Zero timer used to process the queued requests once per event loop turn.
+    QTimer * m_batchTimer;
+
+    //! Current master password prepared for the batches, null if locked.
+    QScopedPointer<Engine::Master> m_master;
+
+    //! Unparsed input per client.
+    QHash<QLocalSocket *, QByteArray> m_input;
+
+    //! Queued GENERATE requests and their logins.
+    QVector<Request> m_pending;
+    LoginIO::LoginList m_pendingLogins;
+
+    //! Generated passwords of the current batch.
+    QVector<QString> m_passwords;
+};
+
+#endif // DAEMON_H
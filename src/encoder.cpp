@@ -0,0 +1,172 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "encoder.h"
+
+// Base64 takes the 32 hex characters three at a time, so output character p
+// is built from bits of hex characters 3 * (p / 4) + 0..2. Every hex character
+// is one nibble of the digest, and no base64 character spans more than two hex
+// characters. This makes each output character a function of at most two
+// nibbles, which is what the table stores: one row of 256 entries per kind of
+// output position, indexed by (first nibble << 4) | second nibble.
+
+namespace
+{
+    //! Base64 alphabet where + and / are already replaced by A and B.
+    const char BASE64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789AB";
+
+    //! Base64 padding '=' replaced by C.
+    const char PADDING = 'C';
+
+    //! Table rows.
+    enum Row
+    {
+        //! First character of a group: high six bits of hex character 0.
+        GROUP_0,
+
+        //! Low two bits of hex character 0 and high four of hex character 1.
+        GROUP_1,
+
+        //! Low four bits of hex character 1 and high two of hex character 2.
+        GROUP_2,
+
+        //! Low six bits of hex character 2.
+        GROUP_3,
+
+        //! Third character of the last, two-byte group.
+        TAIL_2,
+
+        //! The padding character.
+        TAIL_3,
+
+        ROW_COUNT
+    };
+
+    //! First output position of the last, two-byte group.
+    const int TAIL_BEGIN = 40;
+
+    constexpr int hexDigit(int nibble)
+    {
+        return nibble < 10 ? '0' + nibble : 'a' + nibble - 10;
+    }
+
+    constexpr char tableEntry(int row, int a, int b)
+    {
+        return
+            row == GROUP_0 ? BASE64[hexDigit(a) >> 2] :
+            row == GROUP_1 ? BASE64[((hexDigit(a) & 0x3) << 4) | (hexDigit(b) >> 4)] :
+            row == GROUP_2 ? BASE64[((hexDigit(a) & 0xf) << 2) | (hexDigit(b) >> 6)] :
+            row == GROUP_3 ? BASE64[hexDigit(a) & 0x3f] :
+            row == TAIL_2  ? BASE64[(hexDigit(a) & 0xf) << 2] :
+            PADDING;
+    }
+
+    //! Table row of the output position.
+    constexpr int positionRow(int p)
+    {
+        return p < TAIL_BEGIN ? p % 4 : (p % 4 == 2 ? TAIL_2 : (p % 4 == 3 ? TAIL_3 : p % 4));
+    }
+
+    //! Index of the first nibble of the output position.
+    constexpr int firstNibble(int p)
+    {
+        return 3 * (p / 4) + (p % 4 == 0 ? 0 : p % 4 - 1);
+    }
+
+    //! Index of the second nibble of the output position. Positions that
+    //! depend on one nibble only read the always zero nibble past the digest.
+    constexpr int secondNibble(int p)
+    {
+        return positionRow(p) == GROUP_1 || positionRow(p) == GROUP_2 ?
+            firstNibble(p) + 1 : Md5::DIGEST_SIZE * 2;
+    }
+
+    template <int... I>
+    struct Indices {};
+
+    template <int N, int... I>
+    struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+    template <int... I>
+    struct MakeIndices<0, I...>
+    {
+        typedef Indices<I...> Type;
+    };
+
+    //! Where an output character takes its value from.
+    struct Position
+    {
+        quint8 row;
+        quint8 first;
+        quint8 second;
+    };
+
+    template <typename Index>
+    struct Tables;
+
+    //! The lookup tables, generated at compile time.
+    template <int... I>
+    struct Tables<Indices<I...> >
+    {
+        static constexpr char ENTRIES[ROW_COUNT][256] =
+        {
+            {tableEntry(GROUP_0, I / 16, I % 16)...},
+            {tableEntry(GROUP_1, I / 16, I % 16)...},
+            {tableEntry(GROUP_2, I / 16, I % 16)...},
+            {tableEntry(GROUP_3, I / 16, I % 16)...},
+            {tableEntry(TAIL_2,  I / 16, I % 16)...},
+            {tableEntry(TAIL_3,  I / 16, I % 16)...}
+        };
+
+        static constexpr Position POSITIONS[Encoder::OUTPUT_SIZE] =
+        {
+            {static_cast<quint8>(positionRow(I)),
+             static_cast<quint8>(firstNibble(I)),
+             static_cast<quint8>(secondNibble(I))}...
+        };
+    };
+
+    template <int... I>
+    constexpr char Tables<Indices<I...> >::ENTRIES[ROW_COUNT][256];
+
+    template <int... I>
+    constexpr Position Tables<Indices<I...> >::POSITIONS[Encoder::OUTPUT_SIZE];
+
+    typedef Tables<MakeIndices<256>::Type> EntryTables;
+    typedef Tables<MakeIndices<Encoder::OUTPUT_SIZE>::Type> PositionTables;
+}
+
+unsigned int Encoder::encode(const Md5::Digest & digest, unsigned int length, char * rPassword)
+{
+    quint8 nibbles[Md5::DIGEST_SIZE * 2 + 1];
+    for (int i = 0; i < Md5::DIGEST_SIZE; i++)
+    {
+        nibbles[i * 2]     = digest[i] >> 4;
+        nibbles[i * 2 + 1] = digest[i] & 0xf;
+    }
+
+    nibbles[Md5::DIGEST_SIZE * 2] = 0;
+
+    length = qMin(length, OUTPUT_SIZE);
+    for (unsigned int p = 0; p < length; p++)
+    {
+        const Position & pos = PositionTables::POSITIONS[p];
+        rPassword[p] = EntryTables::ENTRIES[pos.row][(nibbles[pos.first] << 4) | nibbles[pos.second]];
+    }
+
+    rPassword[length] = '\0';
+    return length;
+}
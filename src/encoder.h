@@ -0,0 +1,37 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "md5.h"
+
+//! Turns a digest into the password characters. The password is the base64
+//! encoding of the hex digest where +, / and = are replaced by A, B and C.
+namespace Encoder
+{
+    //! Number of characters the encoding of a digest has.
+    const unsigned int OUTPUT_SIZE = 44;
+
+    //! Encode the first length characters of the password to rPassword and
+    //! null-terminate it. rPassword must hold OUTPUT_SIZE + 1 characters.
+    //! Each character is read from a compile-time table indexed by the one or
+    //! two digest nibbles it depends on, so there are no intermediate passes.
+    //! Return the number of characters written.
+    unsigned int encode(const Md5::Digest & digest, unsigned int length, char * rPassword);
+}
+
+#endif // ENCODER_H
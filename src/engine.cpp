@@ -15,22 +15,314 @@
 //
 
 #include "engine.h"
-#include <QCryptographicHash>
+#include "md5.h"
+
+#include <QAtomicInt>
+#include <QThread>
+#include <QVarLengthArray>
+
+#include <cstring>
+
+namespace
+{
+    //! Number of logins a worker takes at a time. Small enough to keep
+    //! the threads balanced, large enough to keep the atomic counter cold.
+    const int BATCH_CHUNK_SIZE = 64;
+
+    //! Convert a character like QString::toLatin1() does.
+    inline char toLatin1(QChar c)
+    {
+        return c.unicode() > 0xff ? '?' : static_cast<char>(c.unicode());
+    }
+
+    //! Write the Latin-1 form of the string to rData.
+    void writeLatin1(const QString & str, char * rData)
+    {
+        const QChar * data = str.constData();
+        for (int i = 0; i < str.size(); i++)
+        {
+            rData[i] = toLatin1(data[i]);
+        }
+    }
+
+    //! Feed the Latin-1 form of the string to the hash in small pieces.
+    void hashLatin1(Md5::Context & context, const QString & str)
+    {
+        const QChar * data = str.constData();
+
+        char buffer[64];
+        for (int i = 0; i < str.size(); i += sizeof(buffer))
+        {
+            const int size = qMin(str.size() - i, static_cast<int>(sizeof(buffer)));
+            for (int j = 0; j < size; j++)
+            {
+                buffer[j] = toLatin1(data[i + j]);
+            }
+
+            context.update(buffer, size);
+        }
+    }
+
+    //! Key the UTF-8 master to HMAC-SHA256.
+    Sha256::Hmac keyMaster(const QString & master)
+    {
+        QByteArray utf8 = master.toUtf8();
+        const Sha256::Hmac hmac(utf8.constData(), utf8.size());
+        utf8.fill('\0');
+        return hmac;
+    }
+
+    //! Shared state of a batch run.
+    struct BatchJob
+    {
+        const Engine::Master     * master;
+        const LoginIO::LoginList * logins;
+        QString                  * passwords;
+        QAtomicInt                 next;
+    };
+
+    //! Take chunks from the job until it's exhausted.
+    void runBatchJob(BatchJob & job)
+    {
+        const int count = job.logins->count();
+        for (;;)
+        {
+            const int begin = job.next.fetchAndAddRelaxed(BATCH_CHUNK_SIZE);
+            if (begin >= count)
+            {
+                return;
+            }
+
+            const int n = qMin(begin + BATCH_CHUNK_SIZE, count) - begin;
+
+            Md5::Digest digests[BATCH_CHUNK_SIZE];
+            job.master->derive(*job.logins, begin, n, digests);
+
+            for (int i = 0; i < n; i++)
+            {
+                Engine::PasswordBuffer password;
+                const unsigned int length = Generator::Legacy::encode(digests[i],
+                    job.logins->at(begin + i).passwordLength(), password);
+                job.passwords[begin + i] = QString::fromLatin1(password, length);
+            }
+        }
+    }
+
+    //! Worker thread that runs a shared batch job.
+    class BatchWorker : public QThread
+    {
+    public:
+
+        explicit BatchWorker(BatchJob & job)
+        : m_job(job)
+        {}
+
+    protected:
+
+        //! \reimp
+        virtual void run()
+        {
+            runBatchJob(m_job);
+        }
+
+    private:
+
+        BatchJob & m_job;
+    };
+}
 
 QString Engine::generate(const QString & master,
                          const QString & url,
                          const QString & user,
                          unsigned int length)
 {
-    // Generate a base64 encoding of md5
-    QByteArray combined = (master + url + user).toLatin1();
-    QByteArray hashed = QCryptographicHash::hash(combined, QCryptographicHash::Md5);
-    hashed = hashed.toHex().toBase64();
+    PasswordBuffer password;
+    const unsigned int size = generate(master, url, user, length, password);
+    return QString::fromLatin1(password, size);
+}
+
+QString Engine::generate(const QString & master, const LoginData & login)
+{
+    return Master(master).generate(login);
+}
+
+unsigned int Engine::generate(const QString & master,
+                              const QString & url,
+                              const QString & user,
+                              unsigned int length,
+                              PasswordBuffer & rPassword)
+{
+    // Hash master + url + user as Latin-1 without building the string
+    Md5::Context context;
+    hashLatin1(context, master);
+    hashLatin1(context, url);
+    hashLatin1(context, user);
+
+    Md5::Digest digest;
+    context.finish(digest);
+
+    return Generator::Legacy::encode(digest, length, rPassword);
+}
+
+unsigned int Engine::generate(const QString & master,
+                              const QString & url,
+                              const QString & user,
+                              unsigned int length,
+                              const Kdf::Params & kdf,
+                              PasswordBuffer & rPassword,
+                              int threads)
+{
+    if (kdf.isLegacy())
+    {
+        return generate(master, url, user, length, rPassword);
+    }
 
-    // Replace possible +, / and = with A, B and C, respectively.
-    hashed = hashed.replace('+', 'A').replace('/', 'B').replace('=', 'C');
+    return Master(master).generate(url, user, length, kdf, rPassword, threads);
+}
+
+Engine::Master::Master(const QString & master)
+: m_hmac(keyMaster(master))
+{
+    QByteArray latin1 = master.toLatin1();
+    m_midstate = Md5::midstate(latin1.constData(), latin1.size());
+    m_tail     = latin1.mid(static_cast<int>(m_midstate.size));
+
+    latin1.fill('\0');
+}
+
+Engine::Master::~Master()
+{
+    m_tail.fill('\0');
+    std::memset(m_midstate.state, 0, sizeof(m_midstate.state));
+}
+
+QString Engine::Master::generate(const LoginData & login) const
+{
+    PasswordBuffer password;
+    const unsigned int size = generate(login.url(), login.userName(),
+        qMax(login.passwordLength(), 0), login.kdf(), password);
+    return QString::fromLatin1(password, size);
+}
+
+unsigned int Engine::Master::generate(const QString & url,
+                                      const QString & user,
+                                      unsigned int length,
+                                      const Kdf::Params & kdf,
+                                      PasswordBuffer & rPassword,
+                                      int threads) const
+{
+    Md5::Digest digest;
+    derive(url, user, kdf, digest, threads);
+    return Generator::Legacy::encode(digest, length, rPassword);
+}
+
+void Engine::Master::derive(const QString & url, const QString & user,
+    const Kdf::Params & kdf, Md5::Digest & rDigest, int threads) const
+{
+    if (kdf.isLegacy())
+    {
+        // Only the rest of the master is hashed again
+        Md5::Context context(m_midstate);
+        context.update(m_tail.constData(), m_tail.size());
+        hashLatin1(context, url);
+        hashLatin1(context, user);
+        context.finish(rDigest);
+        return;
+    }
+
+    QByteArray salt = url.toUtf8();
+    salt += '\0';
+    salt += user.toUtf8();
 
-    // Remove '\n' and return n first chars
-    return hashed.simplified().left(length);
+    Kdf::derive(kdf, m_hmac, salt.constData(), salt.size(), rDigest, Md5::DIGEST_SIZE,
+        threads);
 }
 
+void Engine::Master::derive(const LoginIO::LoginList & logins, int begin, int count,
+    Md5::Digest * rDigests) const
+{
+    // Lay out the rest of the master + url + user as Latin-1 of each login
+    // back to back. The arena stays on the stack unless the logins are
+    // unusually long. Logins with a key derivation get an empty message.
+    QVarLengthArray<int, BATCH_CHUNK_SIZE> sizes(count);
+    int total = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const LoginData & login = logins.at(begin + i);
+        sizes[i] = login.kdf().isLegacy() ?
+            m_tail.size() + login.url().size() + login.userName().size() : 0;
+        total   += sizes[i];
+    }
+
+    QVarLengthArray<char, BATCH_CHUNK_SIZE * 128> arena(total);
+    QVarLengthArray<const char *, BATCH_CHUNK_SIZE> data(count);
+    char * p = arena.data();
+    for (int i = 0; i < count; i++)
+    {
+        data[i] = p;
+        if (sizes[i] > 0)
+        {
+            const LoginData & login = logins.at(begin + i);
+            std::memcpy(p, m_tail.constData(), m_tail.size());
+            p += m_tail.size();
+            writeLatin1(login.url(), p);
+            p += login.url().size();
+            writeLatin1(login.userName(), p);
+            p += login.userName().size();
+        }
+    }
+
+    // Hash all of them with the multi-buffer kernel from the midstate
+    Md5::hashMany(m_midstate, data.constData(), sizes.constData(), count, rDigests);
+
+    // The batch is already spread over the cores, so each
+    // derivation runs on a single thread
+    for (int i = 0; i < count; i++)
+    {
+        const LoginData & login = logins.at(begin + i);
+        if (!login.kdf().isLegacy())
+        {
+            derive(login.url(), login.userName(), login.kdf(), rDigests[i], 1);
+        }
+    }
+}
+
+void Engine::generateBatch(const QString & master,
+                           const LoginIO::LoginList & logins,
+                           QVector<QString> & rPasswords)
+{
+    generateBatch(Master(master), logins, rPasswords);
+}
+
+void Engine::generateBatch(const Master & master,
+                           const LoginIO::LoginList & logins,
+                           QVector<QString> & rPasswords)
+{
+    const int count = logins.count();
+    rPasswords.fill(QString(), count);
+
+    BatchJob job;
+    job.master     = &master;
+    job.logins     = &logins;
+    job.passwords  = rPasswords.data();
+
+    // Don't start more threads than there are chunks. The calling
+    // thread works too, so one worker less is needed.
+    const int chunks  = (count + BATCH_CHUNK_SIZE - 1) / BATCH_CHUNK_SIZE;
+    const int threads = qMin(QThread::idealThreadCount(), chunks);
+
+    QVector<BatchWorker *> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers << new BatchWorker(job);
+        workers.last()->start();
+    }
+
+    runBatchJob(job);
+
+    for (int i = 0; i < workers.count(); i++)
+    {
+        workers.at(i)->wait();
+        delete workers.at(i);
+    }
+}
@@ -17,16 +17,128 @@
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <QByteArray>
 #include <QString>
+#include <QVector>
 
-//! The password generator.
+#include "generator.h"
+#include "kdf.h"
+#include "loginio.h"
+#include "md5.h"
+#include "sha256.h"
+
+//! The password generator. The original derivation is the MD5 of
+//! master + url + user as Latin-1. Logins can instead use a key
+//! derivation of Kdf, with the master password as the password and
+//! url + NUL + user as the salt, all as UTF-8. Either way the
+//! first 16 bytes are encoded by the legacy kernel of Generator.
 namespace Engine
 {
-    //! Generate and return password from the given data.
+    //! Maximum length of a generated password.
+    const unsigned int MAX_LENGTH = Generator::Legacy::OUTPUT_SIZE;
+
+    //! Buffer for a generated, null-terminated password.
+    typedef char PasswordBuffer[MAX_LENGTH + 1];
+
+    //! Generate and return password from the given data with the
+    //! original derivation.
     QString generate(const QString & master,
                      const QString & url,
                      const QString & user,
                      unsigned int length = 8);
+
+    //! Generate and return the password of the login with its
+    //! key derivation.
+    QString generate(const QString & master, const LoginData & login);
+
+    //! Generate password from the given data to rPassword without
+    //! allocating any memory. Lengths over MAX_LENGTH are clamped.
+    //! Return the length of the password.
+    unsigned int generate(const QString & master,
+                          const QString & url,
+                          const QString & user,
+                          unsigned int length,
+                          PasswordBuffer & rPassword);
+
+    //! Like above with the given key derivation, which may use up to
+    //! the given number of threads, zero meaning one per core.
+    unsigned int generate(const QString & master,
+                          const QString & url,
+                          const QString & user,
+                          unsigned int length,
+                          const Kdf::Params & kdf,
+                          PasswordBuffer & rPassword,
+                          int threads = 0);
+
+    //! A master password prepared for generating many passwords. The
+    //! complete MD5 blocks of the master are hashed and the master is
+    //! keyed to the HMAC of the key derivations once, so that each login
+    //! only pays for its own bytes. Wipes its copies of the master when
+    //! destroyed. The generate() functions taking the master as a string
+    //! prepare one for the call.
+    class Master
+    {
+    public:
+
+        //! Constructor.
+        explicit Master(const QString & master);
+
+        //! Destructor.
+        ~Master();
+
+        //! Generate and return the password of the login with its
+        //! key derivation.
+        QString generate(const LoginData & login) const;
+
+        //! Generate the password to rPassword without allocating any memory
+        //! for the original derivation. A key derivation may use up to the
+        //! given number of threads, zero meaning one per core.
+        //! Return the length of the password.
+        unsigned int generate(const QString & url,
+                              const QString & user,
+                              unsigned int length,
+                              const Kdf::Params & kdf,
+                              PasswordBuffer & rPassword,
+                              int threads = 0) const;
+
+        //! Derive the digests fed to the encoding of count logins starting from
+        //! begin to rDigests. The logins with the original derivation are
+        //! hashed together with the multi-buffer MD5. Key derivations run
+        //! on the calling thread only.
+        void derive(const LoginIO::LoginList & logins, int begin, int count,
+            Md5::Digest * rDigests) const;
+
+    private:
+
+        Q_DISABLE_COPY(Master)
+
+        //! Derive the digest of a single login.
+        void derive(const QString & url, const QString & user, const Kdf::Params & kdf,
+            Md5::Digest & rDigest, int threads) const;
+
+        //! MD5 state after the complete blocks of the Latin-1 master.
+        Md5::Midstate m_midstate;
+
+        //! The rest of the Latin-1 master.
+        QByteArray m_tail;
+
+        //! The UTF-8 master keyed to HMAC-SHA256.
+        Sha256::Hmac m_hmac;
+    };
+
+    //! Generate passwords for all given logins with the same master password.
+    //! The work is distributed over all available cores. rPasswords is resized
+    //! to the number of logins and the results are stored in the input order.
+    //! Each password is identical to the one returned by generate() for
+    //! the login. Logins with a key derivation are derived one per thread.
+    void generateBatch(const QString & master,
+                       const LoginIO::LoginList & logins,
+                       QVector<QString> & rPasswords);
+
+    //! Like above with a prepared master password.
+    void generateBatch(const Master & master,
+                       const LoginIO::LoginList & logins,
+                       QVector<QString> & rPasswords);
 }
 
 #endif // ENGINE_H
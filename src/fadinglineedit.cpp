@@ -0,0 +1,177 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "fadinglineedit.h"
+
+#include <QEvent>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionFrame>
+#include <QTimer>
+
+namespace
+{
+    //! Default cap of the repaints per second.
+    const int DEFAULT_FRAME_RATE = 30;
+}
+
+FadingLineEdit::FadingLineEdit(QWidget * parent)
+: QLineEdit(parent)
+, m_frameTimer(new QTimer(this))
+, m_endTimer(new QTimer(this))
+, m_frameRate(0)
+, m_duration(0)
+, m_alpha(0)
+, m_frameCount(0)
+{
+    setFrameRate(DEFAULT_FRAME_RATE);
+    connect(m_frameTimer, SIGNAL(timeout()), this, SLOT(updateFade()));
+
+    m_endTimer->setSingleShot(true);
+    connect(m_endTimer, SIGNAL(timeout()), this, SLOT(finishFade()));
+}
+
+void FadingLineEdit::setFrameRate(int frameRate)
+{
+    m_frameRate = qBound(1, frameRate, 1000);
+    m_frameTimer->setInterval(1000 / m_frameRate);
+}
+
+int FadingLineEdit::frameRate() const
+{
+    return m_frameRate;
+}
+
+void FadingLineEdit::startFade(int duration)
+{
+    m_duration = qMax(duration, 1);
+    m_clock.start();
+    m_endTimer->start(m_duration);
+
+    if (m_alpha != 0)
+    {
+        m_alpha = 0;
+        m_frameCount++;
+        update();
+    }
+
+    updateFrameTimer();
+}
+
+bool FadingLineEdit::isFading() const
+{
+    return m_endTimer->isActive();
+}
+
+int FadingLineEdit::frameCount() const
+{
+    return m_frameCount;
+}
+
+void FadingLineEdit::paintEvent(QPaintEvent * event)
+{
+    QLineEdit::paintEvent(event);
+
+    if (m_alpha > 0)
+    {
+        // Blending the base color over the text is the same as
+        // painting the text with a lower alpha
+        QStyleOptionFrame option;
+        initStyleOption(&option);
+        const QRect contents = style()->subElementRect(QStyle::SE_LineEditContents, &option, this);
+
+        QColor color = palette().color(QPalette::Base);
+        color.setAlpha(m_alpha);
+
+        QPainter painter(this);
+        painter.fillRect(contents, color);
+    }
+}
+
+void FadingLineEdit::showEvent(QShowEvent * event)
+{
+    QLineEdit::showEvent(event);
+
+    // Follow the window, which is minimized and hidden without
+    // its children getting hidden
+    if (m_window != window())
+    {
+        if (m_window)
+        {
+            m_window->removeEventFilter(this);
+        }
+
+        m_window = window();
+        m_window->installEventFilter(this);
+    }
+
+    updateFrameTimer();
+}
+
+bool FadingLineEdit::eventFilter(QObject * object, QEvent * event)
+{
+    if (object == m_window && (event->type() == QEvent::Show ||
+        event->type() == QEvent::Hide || event->type() == QEvent::WindowStateChange))
+    {
+        updateFrameTimer();
+    }
+
+    return QLineEdit::eventFilter(object, event);
+}
+
+void FadingLineEdit::updateFade()
+{
+    const int alpha = currentAlpha();
+    if (alpha != m_alpha)
+    {
+        m_alpha = alpha;
+        m_frameCount++;
+        update();
+    }
+}
+
+void FadingLineEdit::finishFade()
+{
+    m_frameTimer->stop();
+    m_alpha = 255;
+    update();
+
+    emit fadeFinished();
+}
+
+void FadingLineEdit::updateFrameTimer()
+{
+    const bool shown = isVisible() && !window()->isMinimized();
+    if (shown && m_endTimer->isActive())
+    {
+        // Catch up with the time spent hidden
+        updateFade();
+        if (!m_frameTimer->isActive())
+        {
+            m_frameTimer->start();
+        }
+    }
+    else
+    {
+        m_frameTimer->stop();
+    }
+}
+
+int FadingLineEdit::currentAlpha() const
+{
+    return static_cast<int>(qMin(m_clock.elapsed(), static_cast<qint64>(m_duration)) *
+        255 / m_duration);
+}
@@ -0,0 +1,114 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef FADINGLINEEDIT_H
+#define FADINGLINEEDIT_H
+
+#include <QElapsedTimer>
+#include <QLineEdit>
+#include <QPointer>
+
+class QTimer;
+
+//! Line edit whose contents can fade out over time.
+//!
+//! The fade is painted as a translucent layer of the base color over
+//! the contents, so the palette never changes and a frame costs only
+//! the repaint of the edit. Repaints are capped to the frame rate and
+//! skipped when the opacity hasn't visibly changed. No frames are
+//! painted while the window is hidden or minimized, but the fade
+//! still finishes on time.
+class FadingLineEdit : public QLineEdit
+{
+    Q_OBJECT
+
+public:
+
+    //! Constructor.
+    explicit FadingLineEdit(QWidget * parent = 0);
+
+    //! Set the maximum number of repaints per second of the fade.
+    void setFrameRate(int frameRate);
+
+    //! Return the maximum number of repaints per second, 30 by default.
+    int frameRate() const;
+
+    //! Show the contents fully and fade them out during the given
+    //! number of milliseconds. Restarts a running fade.
+    void startFade(int duration);
+
+    //! Return true if a fade is running.
+    bool isFading() const;
+
+    //! Return the number of repaints requested by fades so far.
+    int frameCount() const;
+
+signals:
+
+    //! The contents have faded out completely.
+    void fadeFinished();
+
+protected:
+
+    //! \reimp
+    virtual void paintEvent(QPaintEvent * event);
+
+    //! \reimp
+    virtual void showEvent(QShowEvent * event);
+
+    //! \reimp
+    virtual bool eventFilter(QObject * object, QEvent * event);
+
+private slots:
+
+    //! Repaint if the opacity has changed.
+    void updateFade();
+
+    //! End the fade.
+    void finishFade();
+
+private:
+
+    //! Start or stop the frame timer depending on the visibility.
+    void updateFrameTimer();
+
+    //! Return the alpha of the layer painted over the contents now.
+    int currentAlpha() const;
+
+    //! Drives the repaints of a running fade.
+    QTimer * m_frameTimer;
+
+    //! Ends the fade on time also when no frames are painted.
+    QTimer * m_endTimer;
+
+    //! Time since the start of the fade.
+    QElapsedTimer m_clock;
+
+    int m_frameRate;
+
+    //! Duration of the fade in ms.
+    int m_duration;
+
+    //! Alpha of the layer painted over the contents.
+    int m_alpha;
+
+    int m_frameCount;
+
+    //! Window whose visibility is followed.
+    QPointer<QWidget> m_window;
+};
+
+#endif // FADINGLINEEDIT_H
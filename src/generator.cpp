@@ -0,0 +1,61 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "generator.h"
+
+namespace
+{
+    //! Registry entry of the kernel.
+    template <typename Hash, typename Encoding, typename Alphabet>
+    Generator::Variant variant(int version, const char * name)
+    {
+        typedef Generator::Kernel<Hash, Encoding, Alphabet> K;
+
+        Generator::Variant variant;
+        variant.version    = version;
+        variant.name       = name;
+        variant.digestSize = K::DIGEST_SIZE;
+        variant.outputSize = K::OUTPUT_SIZE;
+        variant.encode     = &K::encode;
+        variant.generate   = &K::generate;
+        return variant;
+    }
+
+    using Generator::Md5Hash;
+    using Generator::Sha256Hash;
+    using Generator::HexBase64;
+    using Generator::Base64;
+    using Generator::LegacyAlphabet;
+    using Generator::SymbolAlphabet;
+
+    //! All kernels, indexed by version.
+    const Generator::Variant VARIANTS[Generator::VERSION_COUNT] =
+    {
+        variant<Md5Hash,    HexBase64, LegacyAlphabet>(0, "md5-hex-legacy"),
+        variant<Sha256Hash, HexBase64, LegacyAlphabet>(1, "sha256-hex-legacy"),
+        variant<Md5Hash,    Base64,    LegacyAlphabet>(2, "md5-base64-legacy"),
+        variant<Sha256Hash, Base64,    LegacyAlphabet>(3, "sha256-base64-legacy"),
+        variant<Md5Hash,    HexBase64, SymbolAlphabet>(4, "md5-hex-symbols"),
+        variant<Sha256Hash, HexBase64, SymbolAlphabet>(5, "sha256-hex-symbols"),
+        variant<Md5Hash,    Base64,    SymbolAlphabet>(6, "md5-base64-symbols"),
+        variant<Sha256Hash, Base64,    SymbolAlphabet>(7, "sha256-base64-symbols")
+    };
+}
+
+const Generator::Variant * Generator::find(int version)
+{
+    return version >= 0 && version < VERSION_COUNT ? &VARIANTS[version] : 0;
+}
@@ -0,0 +1,251 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <QtGlobal>
+
+#include <cstring>
+
+#include "encoder.h"
+#include "md5.h"
+#include "sha256.h"
+
+//! The family of password generators. A generator hashes a message and
+//! encodes the digest with base64 to the password characters. It is put
+//! together at compile time from three policies:
+//!
+//! - Hash:     DIGEST_SIZE and hash(data, size, rDigest).
+//! - Encoding: EXPANSION, the base64 input bytes per digest byte, and
+//!             expand<SIZE>(digest, rInput) that writes them.
+//! - Alphabet: symbol(index) for the 64 base64 values and PADDING.
+//!
+//! The expansion of the digest is unrolled and the padding resolved at
+//! compile time, so the only branch of a kernel is the loop over the base64
+//! groups that the length needs. The kernels are also looked up at runtime
+//! by version from a registry.
+//! Version LEGACY is the original generator of Engine.
+namespace Generator
+{
+    //! MD5 (RFC 1321).
+    struct Md5Hash
+    {
+        enum { DIGEST_SIZE = Md5::DIGEST_SIZE };
+
+        static void hash(const char * data, int size, quint8 * rDigest)
+        {
+            Md5::hash(data, size, *reinterpret_cast<Md5::Digest *>(rDigest));
+        }
+    };
+
+    //! SHA-256 (FIPS 180-4).
+    struct Sha256Hash
+    {
+        enum { DIGEST_SIZE = Sha256::DIGEST_SIZE };
+
+        static void hash(const char * data, int size, quint8 * rDigest)
+        {
+            Sha256::hash(data, size, *reinterpret_cast<Sha256::Digest *>(rDigest));
+        }
+    };
+
+    //! Base64 of the lower case hex digest. The original encoding.
+    struct HexBase64
+    {
+        enum { EXPANSION = 2 };
+
+        template <int SIZE>
+        static void expand(const quint8 * digest, quint8 * rInput)
+        {
+            for (int i = 0; i < SIZE; i++)
+            {
+                rInput[i * 2]     = "0123456789abcdef"[digest[i] >> 4];
+                rInput[i * 2 + 1] = "0123456789abcdef"[digest[i] & 0xf];
+            }
+        }
+    };
+
+    //! Base64 of the digest bytes. Six bits of the digest per character
+    //! instead of three.
+    struct Base64
+    {
+        enum { EXPANSION = 1 };
+
+        template <int SIZE>
+        static void expand(const quint8 * digest, quint8 * rInput)
+        {
+            std::memcpy(rInput, digest, SIZE);
+        }
+    };
+
+    //! Base64 with +, / and = replaced by A, B and C. The original alphabet.
+    struct LegacyAlphabet
+    {
+        enum { PADDING = 'C' };
+
+        static char symbol(int index)
+        {
+            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789AB"[index];
+        }
+    };
+
+    //! Standard base64, for sites that require symbols in passwords.
+    struct SymbolAlphabet
+    {
+        enum { PADDING = '=' };
+
+        static char symbol(int index)
+        {
+            return "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"[index];
+        }
+    };
+
+    //! A generator specialized for the given policies.
+    template <typename Hash, typename Encoding, typename Alphabet>
+    class Kernel
+    {
+    public:
+
+        enum
+        {
+            //! Size of the digest in bytes.
+            DIGEST_SIZE = Hash::DIGEST_SIZE,
+
+            //! Number of bytes that base64 encodes.
+            INPUT_SIZE = DIGEST_SIZE * Encoding::EXPANSION,
+
+            //! Number of characters of the full encoding.
+            OUTPUT_SIZE = (INPUT_SIZE + 2) / 3 * 4
+        };
+
+        //! Encode the first length characters of the password to rPassword
+        //! and null-terminate it. rPassword must hold OUTPUT_SIZE + 1
+        //! characters. Lengths over OUTPUT_SIZE are clamped. Return the
+        //! number of characters.
+        static unsigned int encode(const quint8 * digest, unsigned int length, char * rPassword)
+        {
+            length = qMin<unsigned int>(length, OUTPUT_SIZE);
+
+            // Expand the digest to the base64 input, zero padded to whole groups
+            quint8 input[GROUP_COUNT * 3] = {0};
+            Encoding::template expand<DIGEST_SIZE>(digest, input);
+
+            // Only the groups covering the length are encoded
+            for (unsigned int group = 0; group * 4 < length; group++)
+            {
+                const quint8 * in = input + group * 3;
+                char * out = rPassword + group * 4;
+                out[0] = Alphabet::symbol(in[0] >> 2);
+                out[1] = Alphabet::symbol(((in[0] & 0x3) << 4) | (in[1] >> 4));
+                out[2] = Alphabet::symbol(((in[1] & 0xf) << 2) | (in[2] >> 6));
+                out[3] = Alphabet::symbol(in[2] & 0x3f);
+            }
+
+            // The padding is at fixed positions. Past the length it's
+            // overwritten by the terminator or left unused.
+            for (int i = 0; i < PADDING_SIZE; i++)
+            {
+                rPassword[OUTPUT_SIZE - 1 - i] = static_cast<char>(Alphabet::PADDING);
+            }
+
+            rPassword[length] = '\0';
+            return length;
+        }
+
+        //! Hash the message and encode the digest like above.
+        static unsigned int generate(const char * data, int size, unsigned int length,
+            char * rPassword)
+        {
+            quint8 digest[DIGEST_SIZE];
+            Hash::hash(data, size, digest);
+            return encode(digest, length, rPassword);
+        }
+
+    private:
+
+        enum
+        {
+            //! Number of base64 groups.
+            GROUP_COUNT = OUTPUT_SIZE / 4,
+
+            //! Number of padding characters of the last group.
+            PADDING_SIZE = (3 - INPUT_SIZE % 3) % 3
+        };
+    };
+
+    //! The original generator: MD5, hex then base64 and the A, B, C alphabet.
+    typedef Kernel<Md5Hash, HexBase64, LegacyAlphabet> Legacy;
+
+    //! The original encoding has Encoder's fused tables, which don't expand
+    //! the nibbles that the length doesn't need.
+    template <>
+    inline unsigned int Legacy::encode(const quint8 * digest, unsigned int length,
+        char * rPassword)
+    {
+        return Encoder::encode(*reinterpret_cast<const Md5::Digest *>(digest), length, rPassword);
+    }
+
+    //! Versions of the generator. A version is made of one bit per policy,
+    //! so that the original generator is version 0.
+    enum Version
+    {
+        LEGACY = 0,
+
+        //! Hash policy bit: MD5 or SHA-256.
+        SHA256 = 1,
+
+        //! Encoding policy bit: HexBase64 or Base64.
+        BASE64 = 2,
+
+        //! Alphabet policy bit: LegacyAlphabet or SymbolAlphabet.
+        SYMBOLS = 4
+    };
+
+    //! Number of versions.
+    const int VERSION_COUNT = 8;
+
+    //! Largest number of characters a kernel encodes.
+    const unsigned int MAX_OUTPUT_SIZE = Kernel<Sha256Hash, HexBase64, LegacyAlphabet>::OUTPUT_SIZE;
+
+    //! A kernel in the registry.
+    struct Variant
+    {
+        //! Version of the kernel.
+        int version;
+
+        //! Name of the kernel, e.g. "md5-hex-legacy".
+        const char * name;
+
+        //! Size of the digest in bytes.
+        int digestSize;
+
+        //! Number of characters of the full encoding.
+        unsigned int outputSize;
+
+        //! Kernel::encode().
+        unsigned int (*encode)(const quint8 * digest, unsigned int length, char * rPassword);
+
+        //! Kernel::generate().
+        unsigned int (*generate)(const char * data, int size, unsigned int length,
+            char * rPassword);
+    };
+
+    //! Return the kernel of the version, null if there is none.
+    const Variant * find(int version);
+}
+
+#endif // GENERATOR_H
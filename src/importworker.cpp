@@ -0,0 +1,184 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "importworker.h"
+#include "logincatalog.h"
+#include "trace.h"
+
+#include <QFile>
+
+#include <algorithm>
+
+namespace
+{
+    //! Progress and cancellation are checked after this many logins.
+    const int CHECK_INTERVAL = 1024;
+
+    bool urlLessThan(const LoginData & a, const LoginData & b)
+    {
+        return a.url() < b.url();
+    }
+}
+
+ImportWorker::ImportWorker(const QString & fileName, const LoginTable & current)
+: m_fileName(fileName)
+, m_current(current)
+, m_progress(0)
+, m_canceled(0)
+, m_ok(false)
+, m_read(0)
+, m_unchangedCount(0)
+{}
+
+const QString & ImportWorker::fileName() const
+{
+    return m_fileName;
+}
+
+void ImportWorker::cancel()
+{
+    m_canceled.fetchAndStoreRelaxed(1);
+}
+
+bool ImportWorker::isCanceled() const
+{
+    return const_cast<QAtomicInt &>(m_canceled).fetchAndAddRelaxed(0);
+}
+
+int ImportWorker::progress() const
+{
+    return const_cast<QAtomicInt &>(m_progress).fetchAndAddRelaxed(0);
+}
+
+bool ImportWorker::ok() const
+{
+    return m_ok;
+}
+
+const LoginIO::LoginList & ImportWorker::changes() const
+{
+    return m_changes;
+}
+
+int ImportWorker::unchangedCount() const
+{
+    return m_unchangedCount;
+}
+
+void ImportWorker::run()
+{
+    TRACE_SPAN("ImportWorker::run");
+
+    m_ok = m_fileName.endsWith(".fpmc") ? readCatalog() : readFpm();
+    if (!m_ok || isCanceled())
+    {
+        return;
+    }
+
+    // Sorted so that the changes are applied in a stable order
+    m_changes = m_changed.values();
+    std::sort(m_changes.begin(), m_changes.end(), urlLessThan);
+    m_changed.clear();
+    m_unchangedCount = m_unchanged.count();
+    m_unchanged.clear();
+
+    m_progress.fetchAndStoreRelaxed(PROGRESS_MAX);
+}
+
+void ImportWorker::merge(const LoginData & login)
+{
+    m_read++;
+
+    // A later duplicate in the file may undo an earlier change
+    const int current = m_current.find(login.url());
+    if (current >= 0 &&
+        m_current.at(current).userName() == login.userName() &&
+        m_current.at(current).passwordLength() == login.passwordLength() &&
+        m_current.at(current).kdf() == login.kdf())
+    {
+        m_changed.remove(login.url());
+        m_unchanged.insert(login.url());
+    }
+    else
+    {
+        m_changed.insert(login.url(), login);
+        m_unchanged.remove(login.url());
+    }
+}
+
+bool ImportWorker::readFpm()
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = qMax(file.size(), static_cast<qint64>(1));
+
+    LoginIO::LoginReader reader(&file);
+    LoginData login;
+    while (reader.readNext(login))
+    {
+        merge(login);
+
+        if (m_read % CHECK_INTERVAL == 0)
+        {
+            if (isCanceled())
+            {
+                return false;
+            }
+
+            // The parser reads ahead, so this is slightly early
+            m_progress.fetchAndStoreRelaxed(file.pos() * (PROGRESS_MAX - 1) / size);
+        }
+    }
+
+    return !reader.hasError();
+}
+
+bool ImportWorker::readCatalog()
+{
+    LoginCatalog catalog;
+    if (!catalog.open(m_fileName))
+    {
+        return false;
+    }
+
+    LoginData login;
+    for (int i = 0; i < catalog.count(); i++)
+    {
+        if (!catalog.at(i, login))
+        {
+            return false;
+        }
+
+        merge(login);
+
+        if (m_read % CHECK_INTERVAL == 0)
+        {
+            if (isCanceled())
+            {
+                return false;
+            }
+
+            m_progress.fetchAndStoreRelaxed(
+                static_cast<qint64>(i) * (PROGRESS_MAX - 1) / catalog.count());
+        }
+    }
+
+    return true;
+}
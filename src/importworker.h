@@ -0,0 +1,105 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef IMPORTWORKER_H
+#define IMPORTWORKER_H
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QThread>
+
+#include "loginio.h"
+#include "logintable.h"
+
+//! Reads a .fpm file or a catalog in a background thread and compares it
+//! to the current logins. Only the logins that are new or differ from the
+//! current ones end up in changes(), so re-importing an unchanged file
+//! changes nothing.
+class ImportWorker : public QThread
+{
+public:
+
+    //! Progress reported when done.
+    static const int PROGRESS_MAX = 1000;
+
+    //! Constructor. current is the set of logins to compare to.
+    ImportWorker(const QString & fileName, const LoginTable & current);
+
+    //! Name of the imported file.
+    const QString & fileName() const;
+
+    //! Ask the thread to stop as soon as possible.
+    void cancel();
+
+    //! Return true if cancel() was called.
+    bool isCanceled() const;
+
+    //! Progress from 0 to PROGRESS_MAX.
+    int progress() const;
+
+    //! Return true if the file was read successfully. Valid when finished.
+    bool ok() const;
+
+    //! New and changed logins sorted by url. Valid when finished.
+    const LoginIO::LoginList & changes() const;
+
+    //! Number of urls whose last login in the file is identical to the
+    //! current one. Valid when finished.
+    int unchangedCount() const;
+
+protected:
+
+    //! \reimp
+    virtual void run();
+
+private:
+
+    //! Compare a read login to the current ones.
+    void merge(const LoginData & login);
+
+    //! Read a .fpm file.
+    bool readFpm();
+
+    //! Read a catalog.
+    bool readCatalog();
+
+    QString m_fileName;
+
+    const LoginTable m_current;
+
+    //! Changed logins by url.
+    QHash<QString, LoginData> m_changed;
+
+    //! Urls whose logins are identical to the current ones.
+    QSet<QString> m_unchanged;
+
+    QAtomicInt m_progress;
+
+    QAtomicInt m_canceled;
+
+    bool m_ok;
+
+    //! Number of logins read.
+    int m_read;
+
+    int m_unchangedCount;
+
+    LoginIO::LoginList m_changes;
+};
+
+#endif // IMPORTWORKER_H
@@ -0,0 +1,452 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "kdf.h"
+#include "sha256.h"
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QScopedArrayPointer>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace
+{
+    //! Names of the algorithms in .fpm files, indexed by Kdf::Algorithm.
+    const char * const NAMES[Kdf::ALGORITHM_COUNT] = {"md5", "pbkdf2-sha256", "scrypt"};
+
+    //! Smallest cost of PBKDF2 and scrypt that calibrate() returns.
+    const quint32 MIN_PBKDF2_COST = 1000;
+    const quint32 MIN_SCRYPT_COST = 10;
+
+    //! Shortest timing calibrate() extrapolates from.
+    const qint64 MIN_CALIBRATION_NS = 50 * 1000 * 1000;
+
+    inline quint32 rotate(quint32 x, int n)
+    {
+        return (x << n) | (x >> (32 - n));
+    }
+
+    //! The Salsa20/8 core of scrypt, in place.
+    void salsa208(quint32 * b)
+    {
+        quint32 x[16];
+        std::memcpy(x, b, sizeof(x));
+
+        for (int i = 0; i < 8; i += 2)
+        {
+            // Columns
+            x[ 4] ^= rotate(x[ 0] + x[12],  7);  x[ 8] ^= rotate(x[ 4] + x[ 0],  9);
+            x[12] ^= rotate(x[ 8] + x[ 4], 13);  x[ 0] ^= rotate(x[12] + x[ 8], 18);
+            x[ 9] ^= rotate(x[ 5] + x[ 1],  7);  x[13] ^= rotate(x[ 9] + x[ 5],  9);
+            x[ 1] ^= rotate(x[13] + x[ 9], 13);  x[ 5] ^= rotate(x[ 1] + x[13], 18);
+            x[14] ^= rotate(x[10] + x[ 6],  7);  x[ 2] ^= rotate(x[14] + x[10],  9);
+            x[ 6] ^= rotate(x[ 2] + x[14], 13);  x[10] ^= rotate(x[ 6] + x[ 2], 18);
+            x[ 3] ^= rotate(x[15] + x[11],  7);  x[ 7] ^= rotate(x[ 3] + x[15],  9);
+            x[11] ^= rotate(x[ 7] + x[ 3], 13);  x[15] ^= rotate(x[11] + x[ 7], 18);
+
+            // Rows
+            x[ 1] ^= rotate(x[ 0] + x[ 3],  7);  x[ 2] ^= rotate(x[ 1] + x[ 0],  9);
+            x[ 3] ^= rotate(x[ 2] + x[ 1], 13);  x[ 0] ^= rotate(x[ 3] + x[ 2], 18);
+            x[ 6] ^= rotate(x[ 5] + x[ 4],  7);  x[ 7] ^= rotate(x[ 6] + x[ 5],  9);
+            x[ 4] ^= rotate(x[ 7] + x[ 6], 13);  x[ 5] ^= rotate(x[ 4] + x[ 7], 18);
+            x[11] ^= rotate(x[10] + x[ 9],  7);  x[ 8] ^= rotate(x[11] + x[10],  9);
+            x[ 9] ^= rotate(x[ 8] + x[11], 13);  x[10] ^= rotate(x[ 9] + x[ 8], 18);
+            x[12] ^= rotate(x[15] + x[14],  7);  x[13] ^= rotate(x[12] + x[15],  9);
+            x[14] ^= rotate(x[13] + x[12], 13);  x[15] ^= rotate(x[14] + x[13], 18);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            b[i] += x[i];
+        }
+    }
+
+    //! BlockMix of scrypt from in to out, which are 32 * r words each.
+    void blockMix(const quint32 * in, quint32 * out, int r)
+    {
+        quint32 x[16];
+        std::memcpy(x, in + (2 * r - 1) * 16, sizeof(x));
+
+        for (int i = 0; i < 2 * r; i++)
+        {
+            for (int j = 0; j < 16; j++)
+            {
+                x[j] ^= in[i * 16 + j];
+            }
+
+            salsa208(x);
+
+            // Even blocks go to the first half, odd ones to the second
+            std::memcpy(out + ((i & 1) * r + i / 2) * 16, x, sizeof(x));
+        }
+    }
+
+    //! ROMix of scrypt on a lane of 128 * r bytes in place. v holds
+    //! 32 * r * n words and xy 64 * r words.
+    void roMix(quint8 * lane, quint32 n, int r, quint32 * v, quint32 * xy)
+    {
+        const int words = 32 * r;
+        quint32 * x = xy;
+        quint32 * y = xy + words;
+
+        for (int i = 0; i < words; i++)
+        {
+            x[i] = qFromLittleEndian<quint32>(lane + i * 4);
+        }
+
+        for (quint32 i = 0; i < n; i += 2)
+        {
+            std::memcpy(v + i * words, x, words * 4);
+            blockMix(x, y, r);
+            std::memcpy(v + (i + 1) * words, y, words * 4);
+            blockMix(y, x, r);
+        }
+
+        for (quint32 i = 0; i < n; i += 2)
+        {
+            // Integerify: the first word of the last 64-byte block
+            const quint32 * a = v + (x[(2 * r - 1) * 16] & (n - 1)) * words;
+            for (int k = 0; k < words; k++)
+            {
+                x[k] ^= a[k];
+            }
+            blockMix(x, y, r);
+
+            const quint32 * b = v + (y[(2 * r - 1) * 16] & (n - 1)) * words;
+            for (int k = 0; k < words; k++)
+            {
+                y[k] ^= b[k];
+            }
+            blockMix(y, x, r);
+        }
+
+        for (int i = 0; i < words; i++)
+        {
+            qToLittleEndian<quint32>(x[i], lane + i * 4);
+        }
+    }
+
+    //! Shared state of the lanes of a scrypt run.
+    struct LaneJob
+    {
+        quint8   * lanes;
+        quint32    n;
+        int        r;
+        int        p;
+        QAtomicInt next;
+    };
+
+    //! Mix lanes of the job until all are taken. The scratch memory is
+    //! allocated once per thread.
+    void runLaneJob(LaneJob & job)
+    {
+        int lane = job.next.fetchAndAddRelaxed(1);
+        if (lane >= job.p)
+        {
+            return;
+        }
+
+        QScopedArrayPointer<quint32> v(new quint32[32 * job.r * static_cast<size_t>(job.n)]);
+        QVector<quint32> xy(64 * job.r);
+
+        for (; lane < job.p; lane = job.next.fetchAndAddRelaxed(1))
+        {
+            roMix(job.lanes + lane * 128 * job.r, job.n, job.r, v.data(), xy.data());
+        }
+    }
+
+    //! Worker thread that mixes lanes of a shared job.
+    class LaneWorker : public QThread
+    {
+    public:
+
+        explicit LaneWorker(LaneJob & job)
+        : m_job(job)
+        {}
+
+    protected:
+
+        //! \reimp
+        virtual void run()
+        {
+            runLaneJob(m_job);
+        }
+
+    private:
+
+        LaneJob & m_job;
+    };
+
+    //! Run a derivation and return its duration in ns.
+    qint64 timeDerive(const Kdf::Params & params)
+    {
+        static const char password[] = "calibration";
+        static const char salt[]     = "calibration";
+        quint8 key[Sha256::DIGEST_SIZE];
+
+        QElapsedTimer timer;
+        timer.start();
+        Kdf::derive(params, password, sizeof(password) - 1, salt, sizeof(salt) - 1,
+            key, sizeof(key));
+        return timer.nsecsElapsed();
+    }
+}
+
+Kdf::Params::Params()
+: algorithm(LEGACY_MD5)
+, cost(0)
+{}
+
+Kdf::Params::Params(Algorithm algorithm, quint32 cost)
+: algorithm(algorithm)
+, cost(cost)
+{}
+
+bool Kdf::Params::isLegacy() const
+{
+    return algorithm == LEGACY_MD5;
+}
+
+bool Kdf::Params::isValid() const
+{
+    switch (algorithm)
+    {
+    case LEGACY_MD5:
+        return true;
+
+    case PBKDF2_SHA256:
+        return cost >= 1 && cost <= MAX_PBKDF2_COST;
+
+    case SCRYPT:
+        return cost >= 1 && cost <= MAX_SCRYPT_COST;
+
+    default:
+        return false;
+    }
+}
+
+quint32 Kdf::Params::pack() const
+{
+    return isLegacy() ? 0 : (cost << 8) | algorithm;
+}
+
+bool Kdf::Params::unpack(quint32 value, Params & rParams)
+{
+    const quint32 algorithm = value & 0xff;
+    if (algorithm >= static_cast<quint32>(ALGORITHM_COUNT))
+    {
+        return false;
+    }
+
+    // LEGACY_MD5 only packs to 0
+    const Params params(static_cast<Algorithm>(algorithm), value >> 8);
+    if (!params.isValid() || (params.isLegacy() && value != 0))
+    {
+        return false;
+    }
+
+    rParams = params;
+    return true;
+}
+
+bool Kdf::Params::operator==(const Params & other) const
+{
+    return pack() == other.pack();
+}
+
+bool Kdf::Params::operator!=(const Params & other) const
+{
+    return !(*this == other);
+}
+
+QString Kdf::name(Algorithm algorithm)
+{
+    return NAMES[algorithm];
+}
+
+bool Kdf::parseName(const QString & name, Algorithm & rAlgorithm)
+{
+    for (int i = 0; i < ALGORITHM_COUNT; i++)
+    {
+        if (name == NAMES[i])
+        {
+            rAlgorithm = static_cast<Algorithm>(i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Kdf::derive(const Params & params, const char * password, int passwordSize,
+    const char * salt, int saltSize, quint8 * rKey, int keySize, int threads)
+{
+    derive(params, Sha256::Hmac(password, passwordSize), salt, saltSize, rKey, keySize,
+        threads);
+}
+
+void Kdf::derive(const Params & params, const Sha256::Hmac & password,
+    const char * salt, int saltSize, quint8 * rKey, int keySize, int threads)
+{
+    switch (params.algorithm)
+    {
+    case PBKDF2_SHA256:
+        pbkdf2(password, salt, saltSize, params.cost, rKey, keySize);
+        break;
+
+    case SCRYPT:
+        scrypt(password, salt, saltSize, 1u << params.cost,
+            SCRYPT_R, SCRYPT_P, rKey, keySize, threads);
+        break;
+
+    default:
+        std::memset(rKey, 0, keySize);
+        break;
+    }
+}
+
+void Kdf::pbkdf2(const char * password, int passwordSize, const char * salt, int saltSize,
+    quint32 iterations, quint8 * rKey, int keySize)
+{
+    pbkdf2(Sha256::Hmac(password, passwordSize), salt, saltSize, iterations, rKey, keySize);
+}
+
+void Kdf::pbkdf2(const Sha256::Hmac & password, const char * salt, int saltSize,
+    quint32 iterations, quint8 * rKey, int keySize)
+{
+    QByteArray block(salt, saltSize);
+    block.append(QByteArray(4, '\0'));
+
+    for (quint32 i = 1; keySize > 0; i++)
+    {
+        // U1 = PRF(P, S || INT(i)), T = U1 ^ U2 ^ ... ^ Uc
+        qToBigEndian<quint32>(i, reinterpret_cast<uchar *>(block.data() + saltSize));
+
+        Sha256::Digest u;
+        Sha256::Digest t;
+        password.mac(block.constData(), block.size(), u);
+        std::memcpy(t, u, sizeof(t));
+
+        for (quint32 j = 1; j < iterations; j++)
+        {
+            password.macDigest(u, u);
+            for (int k = 0; k < Sha256::DIGEST_SIZE; k++)
+            {
+                t[k] ^= u[k];
+            }
+        }
+
+        const int size = qMin(keySize, Sha256::DIGEST_SIZE);
+        std::memcpy(rKey, t, size);
+        rKey    += size;
+        keySize -= size;
+
+        std::memset(u, 0, sizeof(u));
+        std::memset(t, 0, sizeof(t));
+    }
+}
+
+void Kdf::scrypt(const char * password, int passwordSize, const char * salt, int saltSize,
+    quint32 n, int r, int p, quint8 * rKey, int keySize, int threads)
+{
+    scrypt(Sha256::Hmac(password, passwordSize), salt, saltSize, n, r, p, rKey, keySize,
+        threads);
+}
+
+void Kdf::scrypt(const Sha256::Hmac & password, const char * salt, int saltSize,
+    quint32 n, int r, int p, quint8 * rKey, int keySize, int threads)
+{
+    // B = PBKDF2(P, S, 1, p * 128 * r)
+    QByteArray lanes(p * 128 * r, '\0');
+    pbkdf2(password, salt, saltSize, 1,
+        reinterpret_cast<quint8 *>(lanes.data()), lanes.size());
+
+    LaneJob job;
+    job.lanes = reinterpret_cast<quint8 *>(lanes.data());
+    job.n     = n;
+    job.r     = r;
+    job.p     = p;
+
+    // The calling thread mixes lanes too
+    const int threadCount = qMin(threads > 0 ? threads : QThread::idealThreadCount(), p);
+
+    QVector<LaneWorker *> workers;
+    for (int i = 1; i < threadCount; i++)
+    {
+        workers << new LaneWorker(job);
+        workers.last()->start();
+    }
+
+    runLaneJob(job);
+
+    for (int i = 0; i < workers.count(); i++)
+    {
+        workers.at(i)->wait();
+        delete workers.at(i);
+    }
+
+    // DK = PBKDF2(P, B, 1, dkLen)
+    pbkdf2(password, lanes.constData(), lanes.size(), 1, rKey, keySize);
+    lanes.fill('\0');
+}
+
+Kdf::Params Kdf::calibrate(Algorithm algorithm, int targetMs)
+{
+    const qint64 target = static_cast<qint64>(targetMs) * 1000 * 1000;
+
+    switch (algorithm)
+    {
+    case PBKDF2_SHA256:
+    {
+        // Time is linear in the iterations, extrapolate from a run
+        // long enough to be measured reliably
+        Params params(PBKDF2_SHA256, MIN_PBKDF2_COST);
+        qint64 elapsed = timeDerive(params);
+        while (elapsed < MIN_CALIBRATION_NS && params.cost < MAX_PBKDF2_COST / 2)
+        {
+            params.cost *= 2;
+            elapsed = timeDerive(params);
+        }
+
+        const double cost = static_cast<double>(params.cost) * target / qMax<qint64>(elapsed, 1);
+        params.cost = static_cast<quint32>(qBound<double>(MIN_PBKDF2_COST, cost, MAX_PBKDF2_COST));
+        return params;
+    }
+
+    case SCRYPT:
+    {
+        // Every step doubles the time, so stop at the cost closest to
+        // the target on a logarithmic scale
+        Params params(SCRYPT, MIN_SCRYPT_COST);
+        qint64 elapsed = timeDerive(params);
+        while (elapsed * 1.4142 < target && params.cost < MAX_SCRYPT_COST)
+        {
+            params.cost++;
+            elapsed = timeDerive(params);
+        }
+
+        return params;
+    }
+
+    default:
+        return Params();
+    }
+}
@@ -0,0 +1,132 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef KDF_H
+#define KDF_H
+
+#include <QString>
+#include <QtGlobal>
+
+#include "sha256.h"
+
+//! Key derivation functions the password engine can run the master
+//! password through instead of the original single MD5. The algorithm
+//! and its cost are chosen per login and saved with it, so that a
+//! password can always be generated again.
+namespace Kdf
+{
+    //! Versions of the derivation. The values are stored, don't change them.
+    enum Algorithm
+    {
+        //! The original unsalted MD5 of master + url + user.
+        LEGACY_MD5    = 0,
+
+        //! PBKDF2-HMAC-SHA256 (RFC 8018). The cost is the iteration count.
+        PBKDF2_SHA256 = 1,
+
+        //! scrypt (RFC 7914) with r = SCRYPT_R and p = SCRYPT_P. The cost
+        //! is log2 of N. The p lanes are derived in parallel.
+        SCRYPT        = 2
+    };
+
+    //! Number of algorithms.
+    const int ALGORITHM_COUNT = 3;
+
+    //! Block size parameter of scrypt.
+    const int SCRYPT_R = 8;
+
+    //! Parallelization parameter of scrypt. Fixed, since it changes the
+    //! output, so a machine with fewer cores just takes longer.
+    const int SCRYPT_P = 4;
+
+    //! Largest cost of each algorithm. Costs read from files above these
+    //! are rejected, so a damaged file can't make derive() run for hours
+    //! or allocate more than 4 * 64 MB.
+    const quint32 MAX_PBKDF2_COST = 0xffffff;
+    const quint32 MAX_SCRYPT_COST = 16;
+
+    //! Algorithm and cost of a derivation.
+    struct Params
+    {
+        //! Constructor. The default is LEGACY_MD5.
+        Params();
+
+        //! Constructor.
+        Params(Algorithm algorithm, quint32 cost);
+
+        //! Return true for LEGACY_MD5.
+        bool isLegacy() const;
+
+        //! Return true if the cost is within the limits of the algorithm.
+        bool isValid() const;
+
+        //! Pack to a single word: the algorithm in the low 8 bits and the
+        //! cost in the rest. LEGACY_MD5 packs to 0.
+        quint32 pack() const;
+
+        //! Unpack a word from pack() to rParams. Return false if the
+        //! algorithm is unknown or the cost is not valid for it, since
+        //! any other derivation would generate a different password.
+        static bool unpack(quint32 value, Params & rParams);
+
+        bool operator==(const Params & other) const;
+        bool operator!=(const Params & other) const;
+
+        Algorithm algorithm;
+
+        quint32 cost;
+    };
+
+    //! Name of the algorithm as stored in .fpm files.
+    QString name(Algorithm algorithm);
+
+    //! Parse a name from name(). Return false if it's unknown.
+    bool parseName(const QString & name, Algorithm & rAlgorithm);
+
+    //! Derive keySize bytes of key to rKey. Uses up to the given number
+    //! of threads, zero meaning one per core. LEGACY_MD5 is not a key
+    //! derivation, Engine handles it, and only zeroes the key here.
+    void derive(const Params & params, const char * password, int passwordSize,
+        const char * salt, int saltSize, quint8 * rKey, int keySize, int threads = 0);
+
+    //! Like above with the password already keyed to HMAC-SHA256, which
+    //! both algorithms use as their PRF. Saves hashing the padded
+    //! password when deriving many keys from the same one.
+    void derive(const Params & params, const Sha256::Hmac & password,
+        const char * salt, int saltSize, quint8 * rKey, int keySize, int threads = 0);
+
+    //! PBKDF2-HMAC-SHA256.
+    void pbkdf2(const char * password, int passwordSize, const char * salt, int saltSize,
+        quint32 iterations, quint8 * rKey, int keySize);
+
+    //! PBKDF2-HMAC-SHA256 with a keyed password.
+    void pbkdf2(const Sha256::Hmac & password, const char * salt, int saltSize,
+        quint32 iterations, quint8 * rKey, int keySize);
+
+    //! scrypt with any parameters. n must be a power of two.
+    void scrypt(const char * password, int passwordSize, const char * salt, int saltSize,
+        quint32 n, int r, int p, quint8 * rKey, int keySize, int threads = 0);
+
+    //! scrypt with a keyed password.
+    void scrypt(const Sha256::Hmac & password, const char * salt, int saltSize,
+        quint32 n, int r, int p, quint8 * rKey, int keySize, int threads = 0);
+
+    //! Return the cost that makes a derivation with the algorithm take
+    //! about targetMs on this machine. Takes about twice the target.
+    Params calibrate(Algorithm algorithm, int targetMs);
+}
+
+#endif // KDF_H
@@ -0,0 +1,429 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+// Load generator for the daemon mode of fleetingpm-cli. Every client
+// thread keeps a window of pipelined GENERATE requests in flight and
+// records the latency of each one.
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QLocalSocket>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include "protocol.h"
+
+namespace
+{
+    //! Command line options.
+    struct Options
+    {
+        Options()
+        : clients(8)
+        , requests(10000)
+        , window(32)
+        , masterFd(-1)
+        {}
+
+        //! Local socket of the daemon.
+        QString socketName;
+
+        //! Number of concurrent clients.
+        int clients;
+
+        //! Requests sent by each client.
+        int requests;
+
+        //! Requests in flight per client.
+        int window;
+
+        //! File descriptor to read a master password from to unlock
+        //! the daemon with, -1 if none.
+        int masterFd;
+
+        //! Master password read from masterFd.
+        QString master;
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: fleetingpm-loadgen --socket SOCKET [--clients N] [--requests N]\n"
+            "                          [--window N] [--master-fd FD]\n"
+            "\n"
+            "Measure the latency and throughput of a fleetingpm-cli daemon.\n"
+            "\n"
+            "  --socket SOCKET   Local socket of the daemon.\n"
+            "  --clients N       Number of concurrent clients (default 8).\n"
+            "  --requests N      Requests sent by each client (default 10000).\n"
+            "  --window N        Pipelined requests in flight per client (default 32).\n"
+            "  --master-fd FD    Unlock the daemon first with a master password\n"
+            "                    read from file descriptor FD.\n");
+    }
+
+    bool parseOptions(const QStringList & args, Options & rOptions)
+    {
+        for (int i = 1; i < args.count(); i++)
+        {
+            const QString & arg = args.at(i);
+            if (i + 1 >= args.count())
+            {
+                return false;
+            }
+
+            const QString value = args.at(++i);
+            if (arg == "--socket")
+            {
+                rOptions.socketName = value;
+            }
+            else if (arg == "--clients" || arg == "--requests" || arg == "--window" ||
+                arg == "--master-fd")
+            {
+                bool ok = false;
+                const int number = value.toInt(&ok);
+                if (!ok || number < 0 || (number == 0 && arg != "--master-fd"))
+                {
+                    return false;
+                }
+
+                if (arg == "--master-fd")
+                {
+                    rOptions.masterFd = number;
+                }
+                else if (arg == "--clients")
+                {
+                    rOptions.clients = number;
+                }
+                else if (arg == "--requests")
+                {
+                    rOptions.requests = number;
+                }
+                else
+                {
+                    rOptions.window = number;
+                }
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        return !rOptions.socketName.isEmpty();
+    }
+
+    //! Read the first line of the given file descriptor.
+    bool readMaster(int fd, QString & rMaster)
+    {
+        QFile file;
+        if (!file.open(fd, QIODevice::ReadOnly))
+        {
+            return false;
+        }
+
+        QByteArray line = file.readLine();
+        while (line.endsWith('\n') || line.endsWith('\r'))
+        {
+            line.chop(1);
+        }
+
+        rMaster = QString::fromUtf8(line.constData(), line.size());
+
+        // Don't leave a copy of the master password lying around
+        line.fill('\0');
+        return !rMaster.isEmpty();
+    }
+
+    //! Append a request frame.
+    void appendRequest(QByteArray & rOut, quint8 type, quint32 id, const QByteArray & body)
+    {
+        uchar header[Protocol::HEADER_SIZE + Protocol::PAYLOAD_HEADER_SIZE];
+        qToBigEndian<quint32>(Protocol::PAYLOAD_HEADER_SIZE + body.size(), header);
+        header[Protocol::HEADER_SIZE] = type;
+        qToBigEndian<quint32>(id, header + Protocol::HEADER_SIZE + 1);
+
+        rOut.append(reinterpret_cast<const char *>(header), sizeof(header));
+        rOut.append(body);
+    }
+
+    //! Body of a GENERATE request.
+    QByteArray generateBody(const QByteArray & url, const QByteArray & user, quint8 length)
+    {
+        uchar size[2];
+        QByteArray body;
+        body.append(static_cast<char>(length));
+        qToBigEndian<quint16>(url.size(), size);
+        body.append(reinterpret_cast<const char *>(size), 2);
+        body.append(url);
+        qToBigEndian<quint16>(user.size(), size);
+        body.append(reinterpret_cast<const char *>(size), 2);
+        body.append(user);
+        return body;
+    }
+
+    //! Extract complete response frames from rInput. Return false on
+    //! a protocol error or a failed request.
+    bool takeResponses(QByteArray & rInput, QVector<quint32> & rIds)
+    {
+        int pos = 0;
+        while (rInput.size() - pos >= Protocol::HEADER_SIZE)
+        {
+            const uchar * data = reinterpret_cast<const uchar *>(rInput.constData() + pos);
+            const int size = qFromBigEndian<quint32>(data);
+            if (size < Protocol::PAYLOAD_HEADER_SIZE)
+            {
+                return false;
+            }
+
+            if (rInput.size() - pos - Protocol::HEADER_SIZE < size)
+            {
+                break;
+            }
+
+            if (data[Protocol::HEADER_SIZE] != Protocol::OK)
+            {
+                return false;
+            }
+
+            rIds << qFromBigEndian<quint32>(data + Protocol::HEADER_SIZE + 1);
+            pos += Protocol::HEADER_SIZE + size;
+        }
+
+        rInput.remove(0, pos);
+        return true;
+    }
+
+    //! Client thread.
+    class Client : public QThread
+    {
+    public:
+
+        Client(const Options & options, int index)
+        : m_options(options)
+        , m_index(index)
+        , m_ok(false)
+        {}
+
+        //! Latencies of the requests in nanoseconds.
+        const QVector<qint64> & latencies() const
+        {
+            return m_latencies;
+        }
+
+        bool ok() const
+        {
+            return m_ok;
+        }
+
+    protected:
+
+        //! \reimp
+        virtual void run()
+        {
+            QLocalSocket socket;
+            socket.connectToServer(m_options.socketName);
+            if (!socket.waitForConnected(5000))
+            {
+                return;
+            }
+
+            // Requests are prebuilt so that only the I/O is timed
+            QVector<QByteArray> requests;
+            for (int i = 0; i < m_options.requests; i++)
+            {
+                const QByteArray url  = QString("host-%1-%2.example.com").arg(m_index).arg(i).toUtf8();
+                const QByteArray user = QString("svc%1").arg(i % 16).toUtf8();
+
+                QByteArray request;
+                appendRequest(request, Protocol::GENERATE, i, generateBody(url, user, 16));
+                requests << request;
+            }
+
+            QVector<qint64> sendTimes(m_options.requests);
+            m_latencies.reserve(m_options.requests);
+
+            QElapsedTimer clock;
+            clock.start();
+
+            QByteArray input;
+            QVector<quint32> ids;
+            int sent = 0;
+            while (m_latencies.count() < m_options.requests)
+            {
+                // Fill the window
+                QByteArray out;
+                while (sent < m_options.requests && sent - m_latencies.count() < m_options.window)
+                {
+                    out += requests.at(sent);
+                    sendTimes[sent++] = clock.nsecsElapsed();
+                }
+
+                if (!out.isEmpty())
+                {
+                    socket.write(out);
+                    socket.flush();
+                }
+
+                if (!socket.waitForReadyRead(5000))
+                {
+                    return;
+                }
+
+                input += socket.readAll();
+
+                ids.clear();
+                if (!takeResponses(input, ids))
+                {
+                    return;
+                }
+
+                const qint64 now = clock.nsecsElapsed();
+                for (int i = 0; i < ids.count(); i++)
+                {
+                    m_latencies << now - sendTimes.at(ids.at(i));
+                }
+            }
+
+            m_ok = true;
+        }
+
+    private:
+
+        const Options & m_options;
+
+        int m_index;
+
+        bool m_ok;
+
+        QVector<qint64> m_latencies;
+    };
+
+    //! Send UNLOCK and wait for the response.
+    bool unlock(const Options & options)
+    {
+        QLocalSocket socket;
+        socket.connectToServer(options.socketName);
+        if (!socket.waitForConnected(5000))
+        {
+            return false;
+        }
+
+        QByteArray out;
+        appendRequest(out, Protocol::UNLOCK, 0, options.master.toUtf8());
+        socket.write(out);
+
+        QByteArray input;
+        QVector<quint32> ids;
+        while (ids.isEmpty())
+        {
+            if (!socket.waitForReadyRead(5000))
+            {
+                return false;
+            }
+
+            input += socket.readAll();
+            if (!takeResponses(input, ids))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    Options options;
+    if (!parseOptions(app.arguments(), options))
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (options.masterFd >= 0)
+    {
+        // Read from a descriptor, an argument would show in the process list
+        if (!readMaster(options.masterFd, options.master))
+        {
+            std::fprintf(stderr, "Cannot read the master password from fd %d.\n",
+                options.masterFd);
+            return EXIT_FAILURE;
+        }
+
+        if (!unlock(options))
+        {
+            std::fprintf(stderr, "Cannot unlock the daemon.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    QVector<Client *> clients;
+    for (int i = 0; i < options.clients; i++)
+    {
+        clients << new Client(options, i);
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+
+    for (int i = 0; i < clients.count(); i++)
+    {
+        clients.at(i)->start();
+    }
+
+    QVector<qint64> latencies;
+    bool ok = true;
+    for (int i = 0; i < clients.count(); i++)
+    {
+        clients.at(i)->wait();
+        ok    = ok && clients.at(i)->ok();
+        latencies += clients.at(i)->latencies();
+        delete clients.at(i);
+    }
+
+    const double seconds = clock.nsecsElapsed() / 1e9;
+
+    if (!ok || latencies.isEmpty())
+    {
+        std::fprintf(stderr, "Requests failed. Is the daemon running and unlocked?\n");
+        return EXIT_FAILURE;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const int count = latencies.count();
+
+    std::printf("requests:  %d\n", count);
+    std::printf("clients:   %d\n", options.clients);
+    std::printf("window:    %d\n", options.window);
+    std::printf("req/s:     %.0f\n", count / seconds);
+    std::printf("p50 (us):  %.1f\n", latencies.at(count / 2) / 1e3);
+    std::printf("p99 (us):  %.1f\n", latencies.at(count * 99 / 100) / 1e3);
+    std::printf("max (us):  %.1f\n", latencies.last() / 1e3);
+
+    return EXIT_SUCCESS;
+}
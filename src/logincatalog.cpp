@@ -0,0 +1,240 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "logincatalog.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+namespace
+{
+    //! Fields of a record.
+    enum Field
+    {
+        URL_OFFSET,
+        URL_SIZE,
+        USER_OFFSET,
+        USER_SIZE,
+        LENGTH,
+        KDF
+    };
+
+    //! Fields of the header.
+    enum HeaderField
+    {
+        HEADER_MAGIC,
+        HEADER_VERSION,
+        HEADER_COUNT,
+        HEADER_RECORDS_OFFSET,
+        HEADER_INDEX_OFFSET,
+        HEADER_STRINGS_OFFSET,
+        HEADER_STRINGS_SIZE
+    };
+
+    quint32 read32(const uchar * data, int field = 0)
+    {
+        return qFromLittleEndian<quint32>(data + field * 4);
+    }
+
+    //! Compare strings like memcmp() with shorter strings sorting first.
+    int compare(const char * a, int aSize, const char * b, int bSize)
+    {
+        const int result = std::memcmp(a, b, qMin(aSize, bSize));
+        return result ? result : aSize - bSize;
+    }
+}
+
+LoginCatalog::LoginCatalog()
+: m_data(0)
+, m_count(0)
+, m_records(0)
+, m_recordSize(RECORD_SIZE)
+, m_index(0)
+, m_strings(0)
+, m_stringsSize(0)
+{}
+
+bool LoginCatalog::open(QString fileName)
+{
+    close();
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = m_file.size();
+    if (size < HEADER_SIZE || size > 0x7fffffffLL)
+    {
+        close();
+        return false;
+    }
+
+    m_data = m_file.map(0, size);
+    if (!m_data)
+    {
+        close();
+        return false;
+    }
+
+    const qint64 count         = read32(m_data, HEADER_COUNT);
+    const qint64 recordsOffset = read32(m_data, HEADER_RECORDS_OFFSET);
+    const qint64 indexOffset   = read32(m_data, HEADER_INDEX_OFFSET);
+    const qint64 stringsOffset = read32(m_data, HEADER_STRINGS_OFFSET);
+    const qint64 stringsSize   = read32(m_data, HEADER_STRINGS_SIZE);
+    const quint32 version      = read32(m_data, HEADER_VERSION);
+
+    // Version 1 records have no key derivation
+    int recordSize = RECORD_SIZE;
+    if (version == 1)
+    {
+        recordSize = RECORD_SIZE_V1;
+    }
+
+    // Strings are checked when they are read so that nothing but
+    // the header is touched here
+    if (std::memcmp(m_data, "FPMC", 4) ||
+        version < 1 || version > VERSION ||
+        count > 0x7fffffff ||
+        recordsOffset + count * recordSize > size ||
+        indexOffset + count * 4 > size ||
+        stringsOffset + stringsSize > size)
+    {
+        close();
+        return false;
+    }
+
+    m_count       = count;
+    m_records     = m_data + recordsOffset;
+    m_recordSize  = recordSize;
+    m_index       = m_data + indexOffset;
+    m_strings     = m_data + stringsOffset;
+    m_stringsSize = stringsSize;
+    return true;
+}
+
+void LoginCatalog::close()
+{
+    if (m_data)
+    {
+        m_file.unmap(const_cast<uchar *>(m_data));
+    }
+
+    m_file.close();
+
+    m_data        = 0;
+    m_count       = 0;
+    m_records     = 0;
+    m_index       = 0;
+    m_strings     = 0;
+    m_stringsSize = 0;
+}
+
+bool LoginCatalog::isOpen() const
+{
+    return m_data != 0;
+}
+
+int LoginCatalog::count() const
+{
+    return m_count;
+}
+
+const uchar * LoginCatalog::recordField(int record, int field) const
+{
+    return m_records + record * m_recordSize + field * 4;
+}
+
+const char * LoginCatalog::string(int record, int field, int & rSize) const
+{
+    const quint32 offset = read32(recordField(record, field));
+    const quint32 size   = read32(recordField(record, field + 1));
+    if (offset > m_stringsSize || size > m_stringsSize - offset)
+    {
+        rSize = 0;
+        return "";
+    }
+
+    rSize = size;
+    return reinterpret_cast<const char *>(m_strings + offset);
+}
+
+bool LoginCatalog::at(int record, LoginData & rLogin) const
+{
+    Kdf::Params kdf;
+    if (m_recordSize > KDF * 4 && !Kdf::Params::unpack(read32(recordField(record, KDF)), kdf))
+    {
+        return false;
+    }
+
+    int userSize = 0;
+    const char * user = string(record, USER_OFFSET, userSize);
+    rLogin = LoginData(url(record), QString::fromUtf8(user, userSize),
+        read32(recordField(record, LENGTH)), kdf);
+    return true;
+}
+
+QString LoginCatalog::url(int record) const
+{
+    int size = 0;
+    const char * url = string(record, URL_OFFSET, size);
+    return QString::fromUtf8(url, size);
+}
+
+int LoginCatalog::sorted(int position) const
+{
+    const quint32 record = read32(m_index + position * 4);
+    return record < static_cast<quint32>(m_count) ? static_cast<int>(record) : 0;
+}
+
+int LoginCatalog::find(const QString & url) const
+{
+    const QByteArray key = url.toUtf8();
+
+    // Binary search of the index
+    int first = 0;
+    int last  = m_count;
+    while (first < last)
+    {
+        const int middle = first + (last - first) / 2;
+        const int record = sorted(middle);
+
+        int size = 0;
+        const char * candidate = string(record, URL_OFFSET, size);
+        const int result = compare(candidate, size, key.constData(), key.size());
+        if (result == 0)
+        {
+            return record;
+        }
+        else if (result < 0)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    return -1;
+}
+
+LoginCatalog::~LoginCatalog()
+{
+    close();
+}
@@ -0,0 +1,122 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef LOGINCATALOG_H
+#define LOGINCATALOG_H
+
+#include <QFile>
+#include <QString>
+
+#include "logindata.h"
+
+//! Read-only view of a binary login catalog (.fpmc). The file is mapped
+//! to memory and logins are looked up in place, so opening a catalog
+//! costs the same regardless of its size.
+//!
+//! All integers are little-endian quint32 and all offsets are from the
+//! start of the file. Strings are UTF-8 without terminators.
+//!
+//! Header (HEADER_SIZE bytes):
+//!   magic "FPMC", version, login count, offset of the records,
+//!   offset of the index, offset of the string table, size of the
+//!   string table, reserved (0).
+//!
+//! Record (RECORD_SIZE bytes, one per login):
+//!   url offset, url size, user offset, user size, password length,
+//!   key derivation as Kdf::Params::pack(). Version 1 records end
+//!   before the key derivation and use the original MD5.
+//!   String offsets are relative to the string table.
+//!
+//! Index: a record number per login, sorted by the url bytes.
+//!
+//! URLs are unique; LoginIO::exportCatalog() keeps the last one of duplicates.
+class LoginCatalog
+{
+public:
+
+    //! Version of the format written by this version. Catalogs whose
+    //! logins all use the original MD5 are written as version 1.
+    static const quint32 VERSION = 2;
+
+    //! Size of the header.
+    static const int HEADER_SIZE = 32;
+
+    //! Size of a record.
+    static const int RECORD_SIZE = 24;
+
+    //! Size of a version 1 record.
+    static const int RECORD_SIZE_V1 = 20;
+
+    //! Constructor.
+    LoginCatalog();
+
+    //! Destructor.
+    ~LoginCatalog();
+
+    //! Map the given catalog. Return false if it can't be read or
+    //! it's not a catalog of a supported version.
+    bool open(QString fileName);
+
+    //! Unmap the catalog.
+    void close();
+
+    //! Return true if a catalog is open.
+    bool isOpen() const;
+
+    //! Number of logins.
+    int count() const;
+
+    //! Read the login of the given record to rLogin. Return false if
+    //! its key derivation is unknown to this version.
+    bool at(int record, LoginData & rLogin) const;
+
+    //! URL of the given record.
+    QString url(int record) const;
+
+    //! Return the record of the url or -1 if there isn't one.
+    int find(const QString & url) const;
+
+    //! Return the record at the given position of the url order.
+    int sorted(int position) const;
+
+private:
+
+    //! Return a pointer to the given quint32 of the record.
+    const uchar * recordField(int record, int field) const;
+
+    //! Return the string at the given offsets of the record, or an
+    //! empty string if it's outside the string table.
+    const char * string(int record, int field, int & rSize) const;
+
+    QFile m_file;
+
+    const uchar * m_data;
+
+    int m_count;
+
+    const uchar * m_records;
+
+    //! Size of a record of the open catalog.
+    int m_recordSize;
+
+    const uchar * m_index;
+
+    const uchar * m_strings;
+
+    quint32 m_stringsSize;
+};
+
+#endif // LOGINCATALOG_H
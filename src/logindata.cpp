@@ -22,10 +22,12 @@ LoginData::LoginData()
 , m_passwordLength(0)
 {}
 
-LoginData::LoginData(QString url, QString userName, int passwordLength)
+LoginData::LoginData(QString url, QString userName, int passwordLength,
+    const Kdf::Params & kdf)
 : m_url(url)
 , m_userName(userName)
 , m_passwordLength(passwordLength)
+, m_kdf(kdf)
 {}
 
 void LoginData::setUrl(QString url)
@@ -57,3 +59,13 @@ int LoginData::passwordLength() const
 {
     return m_passwordLength;
 }
+
+void LoginData::setKdf(const Kdf::Params & kdf)
+{
+    m_kdf = kdf;
+}
+
+Kdf::Params LoginData::kdf() const
+{
+    return m_kdf;
+}
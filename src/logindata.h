@@ -19,8 +19,10 @@
 
 #include <QString>
 
-//! Login data that includes url, username, and password length.
-//! Only this data can be saved.
+#include "kdf.h"
+
+//! Login data that includes url, username, password length and the
+//! key derivation of the password. Only this data can be saved.
 class LoginData
 {
 public:
@@ -29,7 +31,8 @@ public:
     LoginData();
 
     //! Constructor.
-    LoginData(QString url, QString userName, int passwordLength);
+    LoginData(QString url, QString userName, int passwordLength,
+        const Kdf::Params & kdf = Kdf::Params());
 
     //! Set URL/ID.
     void setUrl(QString url);
@@ -49,6 +52,12 @@ public:
     //! Get password length.
     int passwordLength() const;
 
+    //! Set key derivation.
+    void setKdf(const Kdf::Params & kdf);
+
+    //! Get key derivation. LEGACY_MD5 unless set.
+    Kdf::Params kdf() const;
+
 private:
 
     //! URL/ID
@@ -59,6 +68,9 @@ private:
 
     //! Password length
     int m_passwordLength;
+
+    //! Key derivation
+    Kdf::Params m_kdf;
 };
 
 #endif // LOGINDATA_H
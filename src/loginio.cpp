@@ -16,86 +16,537 @@
 
 #include <QFile>
 #include <QDate>
-#include <QTextStream>
-#include <QDomDocument>
-#include <QDomElement>
+#include <QHash>
+#include <QVector>
+#include <QXmlStreamAttributes>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#if QT_VERSION >= 0x050100
+#include <QSaveFile>
+#elif defined(Q_OS_WIN)
+#include <QDir>
+#include <io.h>
+#include <windows.h>
+#else
+#include <cstdio>
+#include <unistd.h>
+#endif
 
 #include "loginio.h"
+#include "logincatalog.h"
 #include "config.h"
 
-bool LoginIO::importLogins(LoginIO::LoginList & rLogins, QString fileName)
+namespace
+{
+    //! Output is written to the file in blocks of this size.
+    const int WRITE_BUFFER_SIZE = 64 * 1024;
+
+    //! Append a little-endian quint32.
+    void append32(QByteArray & rOut, quint32 value)
+    {
+        uchar data[4];
+        qToLittleEndian<quint32>(value, data);
+        rOut.append(reinterpret_cast<const char *>(data), 4);
+    }
+
+    //! Orders logins by the UTF-8 bytes of their urls.
+    class UrlLess
+    {
+    public:
+
+        explicit UrlLess(const QVector<QByteArray> & urls)
+        : m_urls(urls)
+        {}
+
+        bool operator()(int a, int b) const
+        {
+            const QByteArray & x = m_urls.at(a);
+            const QByteArray & y = m_urls.at(b);
+            const int result = std::memcmp(x.constData(), y.constData(), qMin(x.size(), y.size()));
+            return result ? result < 0 : x.size() < y.size();
+        }
+
+    private:
+
+        const QVector<QByteArray> & m_urls;
+    };
+
+    //! Append an attribute value escaped the way QDom escapes it.
+    void appendEscaped(QByteArray & rOut, const QString & value)
+    {
+        // The special characters are all ASCII, so UTF-8 can be escaped bytewise
+        const QByteArray utf8 = value.toUtf8();
+        for (int i = 0; i < utf8.size(); i++)
+        {
+            const char c = utf8.at(i);
+            switch (c)
+            {
+            case '<':  rOut += "&lt;";   break;
+            case '"':  rOut += "&quot;"; break;
+            case '&':  rOut += "&amp;";  break;
+            case '\n': rOut += "&#xa;";  break;
+            case '\r': rOut += "&#xd;";  break;
+            case '\t': rOut += "&#x9;";  break;
+            case '>':
+                rOut += i >= 2 && utf8.at(i - 1) == ']' && utf8.at(i - 2) == ']' ? "&gt;" : ">";
+                break;
+            default:   rOut += c;        break;
+            }
+        }
+    }
+}
+
+QIODevice * LoginIO::openSaveFile(const QString & fileName, QIODevice::OpenMode mode)
+{
+#if QT_VERSION >= 0x050100
+    QIODevice * file = new QSaveFile(fileName);
+#else
+    QIODevice * file = new QFile(fileName + ".part");
+#endif
+
+    if (!file->open(QIODevice::WriteOnly | mode))
+    {
+        delete file;
+        return 0;
+    }
+
+    return file;
+}
+
+bool LoginIO::commitSaveFile(QIODevice * file, const QString & fileName)
+{
+#if QT_VERSION >= 0x050100
+    return static_cast<QSaveFile *>(file)->commit();
+#else
+    // Sync the content to disk before it replaces the old file
+    QFile * part = static_cast<QFile *>(file);
+    bool ok = part->flush();
+#ifdef Q_OS_WIN
+    ok = ok && _commit(part->handle()) == 0;
+#else
+    ok = ok && fsync(part->handle()) == 0;
+#endif
+    part->close();
+    ok = ok && part->error() == QFile::NoError;
+
+    // QFile::rename() doesn't overwrite, the system calls replace the
+    // old file atomically
+    const QString partName = fileName + ".part";
+#ifdef Q_OS_WIN
+    ok = ok && MoveFileExW(
+        reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(partName).utf16()),
+        reinterpret_cast<const wchar_t *>(QDir::toNativeSeparators(fileName).utf16()),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+    ok = ok && ::rename(QFile::encodeName(partName).constData(),
+        QFile::encodeName(fileName).constData()) == 0;
+#endif
+
+    if (!ok)
+    {
+        QFile::remove(partName);
+    }
+
+    return ok;
+#endif
+}
+
+void LoginIO::discardSaveFile(QIODevice * file, const QString & fileName)
+{
+#if QT_VERSION < 0x050100
+    file->close();
+    QFile::remove(fileName + ".part");
+#else
+    // QSaveFile discards uncommitted content itself
+    Q_UNUSED(file);
+    Q_UNUSED(fileName);
+#endif
+}
+
+LoginIO::LoginReader::LoginReader(QIODevice * device)
+: m_xml(device)
+, m_inRoot(false)
+{}
+
+bool LoginIO::LoginReader::readNext(LoginData & rLogin)
+{
+    while (!m_xml.atEnd())
+    {
+        if (m_xml.readNext() != QXmlStreamReader::StartElement)
+        {
+            continue;
+        }
+
+        if (!m_inRoot)
+        {
+            m_inRoot = true;
+            continue;
+        }
+
+        // Logins are the direct children of the root, anything else is skipped
+        const bool isKdfLogin = m_xml.name() == "kdflogin";
+        const bool isLogin    = isKdfLogin || m_xml.name() == "login";
+        if (isLogin)
+        {
+            const QXmlStreamAttributes attributes = m_xml.attributes();
+            rLogin = LoginData(attributes.value("url").toString(),
+                attributes.value("user").toString(),
+                attributes.value("length").toString().toInt());
+
+            // Logins without a key derivation use the original MD5
+            if (isKdfLogin || attributes.hasAttribute("kdf"))
+            {
+                Kdf::Params kdf;
+                bool costOk = false;
+                const bool nameOk = Kdf::parseName(attributes.value("kdf").toString(), kdf.algorithm);
+                kdf.cost = attributes.value("cost").toString().toUInt(&costOk);
+                if (!nameOk || !costOk || !kdf.isValid())
+                {
+                    m_xml.raiseError(QString("Invalid key derivation of the login '%1'")
+                        .arg(rLogin.url()));
+                    return false;
+                }
+
+                rLogin.setKdf(kdf);
+            }
+        }
+
+        m_xml.skipCurrentElement();
+
+        if (isLogin && !m_xml.hasError())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool LoginIO::LoginReader::hasError() const
+{
+    return m_xml.hasError();
+}
+
+QString LoginIO::LoginReader::errorString() const
 {
-    QDomDocument doc;
+    return m_xml.errorString();
+}
 
+bool LoginIO::importLogins(QString fileName, const LoginCallback & callback)
+{
     QFile file(fileName);
     if (!file.open(QIODevice::ReadOnly))
     {
         return false;
     }
 
-    if (!doc.setContent(&file))
+    LoginReader reader(&file);
+    LoginData   login;
+    while (reader.readNext(login))
+    {
+        callback(login);
+    }
+
+    return !reader.hasError();
+}
+
+bool LoginIO::importLogins(LoginIO::LoginList & rLogins, QString fileName)
+{
+    LoginList logins;
+    if (!importLogins(fileName, [&logins](const LoginData & login) { logins << login; }))
+    {
+        return false;
+    }
+
+    rLogins = logins;
+    return true;
+}
+
+LoginIO::LoginWriter::LoginWriter()
+: m_count(0)
+, m_ok(false)
+{}
+
+bool LoginIO::LoginWriter::open(QString fileName)
+{
+    m_fileName = fileName;
+    m_count    = 0;
+    m_buffer.clear();
+
+    m_file.reset(openSaveFile(fileName, QIODevice::Text));
+    m_ok = !m_file.isNull();
+    if (!m_ok)
     {
-        file.close();
         return false;
     }
 
-    file.close();
+    // Same layout as QDomDocument::toString() so that older versions
+    // can import the output
+    m_buffer.reserve(WRITE_BUFFER_SIZE + 1024);
+    m_buffer += "<!--";
+    m_buffer += (QString("Generated by ") + Config::NAME + " on " +
+        QDate::currentDate().toString()).toUtf8();
+    m_buffer += "-->\n<logins version=\"";
+    m_buffer += Config::VERSION;
+    m_buffer += '"';
+    return true;
+}
 
-    QDomElement root = doc.documentElement();
-    QDomNode    node = root.firstChild();
+bool LoginIO::LoginWriter::write(const LoginData & login)
+{
+    if (m_count++ == 0)
+    {
+        m_buffer += ">\n";
+    }
 
-    rLogins.clear();
+    // Older versions read only <login> elements and would generate the
+    // original MD5 password for a login that needs the key derivation
+    const Kdf::Params kdf = login.kdf();
+    m_buffer += kdf.isLegacy() ? " <login url=\"" : " <kdflogin url=\"";
+    appendEscaped(m_buffer, login.url());
+    m_buffer += "\" user=\"";
+    appendEscaped(m_buffer, login.userName());
+    m_buffer += "\" length=\"";
+    m_buffer += QByteArray::number(login.passwordLength());
 
-    while(!node.isNull())
+    if (!kdf.isLegacy())
     {
-        QDomElement tag = node.toElement();
-        if(!tag.isNull())
+        m_buffer += "\" kdf=\"";
+        m_buffer += Kdf::name(kdf.algorithm).toLatin1();
+        m_buffer += "\" cost=\"";
+        m_buffer += QByteArray::number(kdf.cost);
+    }
+
+    m_buffer += "\"/>\n";
+
+    return m_buffer.size() < WRITE_BUFFER_SIZE || flush();
+}
+
+bool LoginIO::LoginWriter::flush()
+{
+    m_ok = m_ok && m_file->write(m_buffer) == m_buffer.size();
+    m_buffer.resize(0);
+    return m_ok;
+}
+
+bool LoginIO::LoginWriter::commit()
+{
+    if (m_file.isNull())
+    {
+        return false;
+    }
+
+    m_buffer += m_count ? "</logins>\n" : "/>\n";
+    if (!flush())
+    {
+        return false;
+    }
+
+    m_ok = commitSaveFile(m_file.data(), m_fileName);
+    m_file.reset();
+    return m_ok;
+}
+
+LoginIO::LoginWriter::~LoginWriter()
+{
+    // Remove the partial output of an export that wasn't committed
+    if (!m_file.isNull())
+    {
+        discardSaveFile(m_file.data(), m_fileName);
+    }
+}
+
+bool LoginIO::exportLogins(const LoginIO::LoginList & logins, QString fileName)
+{
+    LoginWriter writer;
+    if (!writer.open(fileName))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < logins.count(); i++)
+    {
+        if (!writer.write(logins.at(i)))
         {
-            if (tag.nodeName() == "login")
-            {
-                QString url    = tag.attribute("url", "");
-                QString user   = tag.attribute("user", "");
-                int     length = tag.attribute("length", 0).toInt();
+            return false;
+        }
+    }
 
-                rLogins << LoginData(url, user, length);
-            }
+    return writer.commit();
+}
+
+bool LoginIO::importCatalog(LoginIO::LoginList & rLogins, QString fileName)
+{
+    LoginCatalog catalog;
+    if (!catalog.open(fileName))
+    {
+        return false;
+    }
+
+    LoginList logins;
+    logins.reserve(catalog.count());
 
-            node = node.nextSibling();
+    LoginData login;
+    for (int i = 0; i < catalog.count(); i++)
+    {
+        if (!catalog.at(catalog.sorted(i), login))
+        {
+            return false;
         }
+
+        logins << login;
     }
 
+    rLogins = logins;
     return true;
 }
 
-bool LoginIO::exportLogins(LoginIO::LoginList logins, QString fileName)
+bool LoginIO::exportCatalog(const LoginIO::LoginList & logins, QString fileName)
 {
-    // Create content
-    QDomDocument doc;
-    QDomComment header = doc.createComment(QString("Generated by ") + Config::NAME + " on " +
-                                           QDate::currentDate().toString());
-    doc.appendChild(header);
+    QVector<QByteArray> urls(logins.count());
+    QVector<int>        order(logins.count());
+    for (int i = 0; i < logins.count(); i++)
+    {
+        urls[i]  = logins.at(i).url().toUtf8();
+        order[i] = i;
+    }
 
-    QDomElement root = doc.createElement("logins");
-    root.setAttribute("version", Config::VERSION);
-    doc.appendChild(root);
+    // Sort by url and keep the last of duplicates like importing does
+    const UrlLess less(urls);
+    std::stable_sort(order.begin(), order.end(), less);
+
+    QVector<int> sorted;
+    sorted.reserve(order.count());
+    for (int i = 0; i < order.count(); i++)
+    {
+        if (i + 1 < order.count() && !less(order.at(i), order.at(i + 1)))
+        {
+            continue;
+        }
+
+        sorted << order.at(i);
+    }
 
+    // Records are stored in the order of the input, the index maps
+    // the url order to them
+    QVector<int> records(logins.count(), -1);
+    for (int i = 0; i < sorted.count(); i++)
+    {
+        records[sorted.at(i)] = 0;
+    }
+
+    // Older versions can read the catalog if no login needs the key derivation
+    bool legacy = true;
+    for (int i = 0; legacy && i < sorted.count(); i++)
+    {
+        legacy = logins.at(sorted.at(i)).kdf().isLegacy();
+    }
+
+    QByteArray recordData;
+    QByteArray strings;
+    QHash<QByteArray, quint32> userOffsets;
+    recordData.reserve(sorted.count() * LoginCatalog::RECORD_SIZE);
+
+    int count = 0;
     for (int i = 0; i < logins.count(); i++)
     {
-        QDomElement loginTag = doc.createElement("login");
-        loginTag.setAttribute("url",    logins.at(i).url());
-        loginTag.setAttribute("user",   logins.at(i).userName());
-        loginTag.setAttribute("length", logins.at(i).passwordLength());
-        root.appendChild(loginTag);
+        if (records.at(i) < 0)
+        {
+            continue;
+        }
+
+        records[i] = count++;
+
+        // User names repeat a lot, so they're stored once
+        const QByteArray user = logins.at(i).userName().toUtf8();
+        if (!userOffsets.contains(user))
+        {
+            userOffsets.insert(user, strings.size());
+            strings += user;
+        }
+
+        append32(recordData, strings.size());
+        append32(recordData, urls.at(i).size());
+        append32(recordData, userOffsets.value(user));
+        append32(recordData, user.size());
+        append32(recordData, logins.at(i).passwordLength());
+        if (!legacy)
+        {
+            append32(recordData, logins.at(i).kdf().pack());
+        }
+
+        strings += urls.at(i);
+    }
+
+    QByteArray index;
+    index.reserve(count * 4);
+    for (int i = 0; i < sorted.count(); i++)
+    {
+        append32(index, records.at(sorted.at(i)));
     }
 
-    QFile file(fileName);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+    const qint64 size = LoginCatalog::HEADER_SIZE + static_cast<qint64>(recordData.size()) +
+        index.size() + strings.size();
+    if (size > 0x7fffffffLL)
     {
-        QTextStream out(&file);
-        out << doc.toString();
-        file.close();
-        return true;
+        return false;
     }
 
-    return false;
+    QByteArray header("FPMC", 4);
+    append32(header, legacy ? 1 : LoginCatalog::VERSION);
+    append32(header, count);
+    append32(header, LoginCatalog::HEADER_SIZE);
+    append32(header, LoginCatalog::HEADER_SIZE + recordData.size());
+    append32(header, LoginCatalog::HEADER_SIZE + recordData.size() + index.size());
+    append32(header, strings.size());
+    append32(header, 0);
+
+    QScopedPointer<QIODevice> file(openSaveFile(fileName, QIODevice::NotOpen));
+    if (file.isNull())
+    {
+        return false;
+    }
+
+    if (file->write(header) != header.size() ||
+        file->write(recordData) != recordData.size() ||
+        file->write(index) != index.size() ||
+        file->write(strings) != strings.size() ||
+        !commitSaveFile(file.data(), fileName))
+    {
+        discardSaveFile(file.data(), fileName);
+        return false;
+    }
+
+    return true;
+}
+
+bool LoginIO::convertToCatalog(QString fpmFileName, QString catalogFileName)
+{
+    LoginList logins;
+    return importLogins(logins, fpmFileName) && exportCatalog(logins, catalogFileName);
+}
+
+bool LoginIO::convertToFpm(QString catalogFileName, QString fpmFileName)
+{
+    LoginCatalog catalog;
+    LoginWriter  writer;
+    if (!catalog.open(catalogFileName) || !writer.open(fpmFileName))
+    {
+        return false;
+    }
+
+    // Logins are streamed from the mapped file
+    LoginData login;
+    for (int i = 0; i < catalog.count(); i++)
+    {
+        if (!catalog.at(catalog.sorted(i), login) || !writer.write(login))
+        {
+            return false;
+        }
+    }
+
+    return writer.commit();
 }
@@ -17,8 +17,14 @@
 #ifndef LOGINIO_H
 #define LOGINIO_H
 
+#include <QByteArray>
+#include <QIODevice>
 #include <QList>
+#include <QScopedPointer>
 #include <QString>
+#include <QXmlStreamReader>
+
+#include <functional>
 
 #include "logindata.h"
 
@@ -27,11 +33,109 @@ namespace LoginIO
 {
     typedef QList<LoginData> LoginList;
 
-    //! Import logins from a file to rLogins.
+    //! Function receiving the imported logins one at a time.
+    typedef std::function<void (const LoginData & login)> LoginCallback;
+
+    //! Pull parser reading the <login> and <kdflogin> elements of a .fpm
+    //! file one at a time. Only the current element is kept in memory.
+    class LoginReader
+    {
+    public:
+
+        //! Constructor. The device must be open for reading.
+        explicit LoginReader(QIODevice * device);
+
+        //! Read the next login to rLogin. Return false at the end
+        //! of the file or on a parse error.
+        bool readNext(LoginData & rLogin);
+
+        //! Return true if the file is not a valid .fpm file.
+        bool hasError() const;
+
+        //! Description of the parse error.
+        QString errorString() const;
+
+    private:
+
+        QXmlStreamReader m_xml;
+
+        //! True after the root element has been read.
+        bool m_inRoot;
+    };
+
+    //! Import logins from a file and pass them to the callback as they are
+    //! read. Logins read before a parse error have already been delivered
+    //! when false is returned.
+    bool importLogins(QString fileName, const LoginCallback & callback);
+
+    //! Import logins from a file to rLogins. rLogins is left untouched
+    //! if the file can't be read.
     bool importLogins(LoginList & rLogins, QString fileName);
 
+    //! Writes a .fpm file one login at a time. The output goes to a
+    //! temporary file that replaces the target only on commit(), so an
+    //! interrupted export never leaves a truncated file behind.
+    class LoginWriter
+    {
+    public:
+
+        //! Constructor.
+        LoginWriter();
+
+        //! Destructor. Discards the output unless committed.
+        ~LoginWriter();
+
+        //! Start writing a file. Return false if it can't be created.
+        bool open(QString fileName);
+
+        //! Append a login.
+        bool write(const LoginData & login);
+
+        //! Finish the file and move it in place of the target.
+        bool commit();
+
+    private:
+
+        //! Write the buffered output to the file.
+        bool flush();
+
+        QString m_fileName;
+
+        QScopedPointer<QIODevice> m_file;
+
+        QByteArray m_buffer;
+
+        int m_count;
+
+        bool m_ok;
+    };
+
     //! Export logins to a file.
-    bool exportLogins(LoginList logins, QString fileName);
+    bool exportLogins(const LoginList & logins, QString fileName);
+
+    //! Import all logins of a binary catalog to rLogins in url order.
+    //! See LoginCatalog for the format.
+    bool importCatalog(LoginList & rLogins, QString fileName);
+
+    //! Export logins to a binary catalog.
+    bool exportCatalog(const LoginList & logins, QString fileName);
+
+    //! Convert a .fpm file to a binary catalog.
+    bool convertToCatalog(QString fpmFileName, QString catalogFileName);
+
+    //! Convert a binary catalog to a .fpm file.
+    bool convertToFpm(QString catalogFileName, QString fpmFileName);
+
+    //! Open a file whose content replaces fileName only when committed.
+    //! Return 0 if it can't be created.
+    QIODevice * openSaveFile(const QString & fileName, QIODevice::OpenMode mode);
+
+    //! Sync the content of a file from openSaveFile() to disk and move it
+    //! in place of fileName. The old file is kept if this fails.
+    bool commitSaveFile(QIODevice * file, const QString & fileName);
+
+    //! Throw away the content of a file from openSaveFile().
+    void discardSaveFile(QIODevice * file, const QString & fileName);
 }
 
 #endif // LOGINIO_H
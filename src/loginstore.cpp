@@ -0,0 +1,546 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "loginstore.h"
+#include "config.h"
+#include "logincatalog.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSettings>
+#include <QStringList>
+#include <QThread>
+#include <QtEndian>
+
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //! Journal record types.
+    enum RecordType
+    {
+        SAVE   = 1,
+        REMOVE = 2
+    };
+
+    //! Smallest journal that is compacted.
+    const qint64 MIN_COMPACT_SIZE = 1024 * 1024;
+
+    typedef QHash<QString, LoginData> LoginHash;
+
+    //! Sync the written content of a file to disk.
+    bool syncToDisk(QFile & file)
+    {
+#ifdef Q_OS_WIN
+        return _commit(file.handle()) == 0;
+#else
+        return fsync(file.handle()) == 0;
+#endif
+    }
+
+    QString snapshotName(const QString & directory, int generation)
+    {
+        return directory + QString("/snapshot.%1").arg(generation);
+    }
+
+    QString journalName(const QString & directory, int generation)
+    {
+        return directory + QString("/journal.%1").arg(generation);
+    }
+
+    //! Return the generations of the files with the given prefix in ascending order.
+    QList<int> generations(const QString & directory, const QString & prefix)
+    {
+        QList<int> result;
+        const QStringList names = QDir(directory).entryList(QStringList(prefix + ".*"), QDir::Files);
+        for (int i = 0; i < names.count(); i++)
+        {
+            bool ok = false;
+            const int generation = names.at(i).mid(prefix.length() + 1).toInt(&ok);
+            if (ok && generation >= 0)
+            {
+                result << generation;
+            }
+        }
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void append32(QByteArray & rOut, quint32 value)
+    {
+        uchar data[4];
+        qToLittleEndian<quint32>(value, data);
+        rOut.append(reinterpret_cast<const char *>(data), 4);
+    }
+
+    quint32 read32(const char * data)
+    {
+        return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data));
+    }
+
+    void appendString(QByteArray & rOut, const QString & value)
+    {
+        const QByteArray utf8 = value.toUtf8();
+        append32(rOut, utf8.size());
+        rOut += utf8;
+    }
+
+    bool readString(const char * data, int size, int & rPos, QString & rValue)
+    {
+        if (size - rPos < 4)
+        {
+            return false;
+        }
+
+        const quint32 length = read32(data + rPos);
+        rPos += 4;
+        if (length > static_cast<quint32>(size - rPos))
+        {
+            return false;
+        }
+
+        rValue = QString::fromUtf8(data + rPos, length);
+        rPos  += length;
+        return true;
+    }
+
+    //! Append a journal record: quint32 payload size, the payload and a
+    //! quint16 checksum of the payload. The payload is the record type,
+    //! the url, the user name, the password length and, unless the login
+    //! uses the original MD5, the packed key derivation. Strings are UTF-8
+    //! preceded by their size. All integers are little-endian.
+    void appendRecord(QByteArray & rOut, RecordType type, const LoginData & login)
+    {
+        QByteArray payload;
+        payload += static_cast<char>(type);
+        appendString(payload, login.url());
+        appendString(payload, login.userName());
+        append32(payload, login.passwordLength());
+        if (!login.kdf().isLegacy())
+        {
+            append32(payload, login.kdf().pack());
+        }
+
+        uchar checksum[2];
+        qToLittleEndian<quint16>(qChecksum(payload.constData(), payload.size()), checksum);
+
+        append32(rOut, payload.size());
+        rOut += payload;
+        rOut.append(reinterpret_cast<const char *>(checksum), 2);
+    }
+
+    //! Apply the records of a journal to rLogins. Return the size of the
+    //! valid part, which is shorter than the file if a record is torn, or
+    //! -1 if an intact record has a key derivation unknown to this version.
+    qint64 replayJournal(const QString & fileName, LoginHash & rLogins)
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            return 0;
+        }
+
+        const QByteArray data = file.readAll();
+
+        int pos = 0;
+        while (data.size() - pos >= 4)
+        {
+            const quint32 size = read32(data.constData() + pos);
+            if (static_cast<qint64>(size) + 6 > data.size() - pos)
+            {
+                break;
+            }
+
+            const char * payload = data.constData() + pos + 4;
+            const quint16 checksum = qFromLittleEndian<quint16>(
+                reinterpret_cast<const uchar *>(payload + size));
+            if (checksum != qChecksum(payload, size))
+            {
+                break;
+            }
+
+            QString url;
+            QString user;
+            int     field = 1;
+            if (size < 1 ||
+                !readString(payload, size, field, url) ||
+                !readString(payload, size, field, user) ||
+                (size - field != 4 && size - field != 8))
+            {
+                break;
+            }
+
+            if (payload[0] == SAVE)
+            {
+                // Not a torn record, so don't truncate the journal here
+                Kdf::Params kdf;
+                if (size - field == 8 && !Kdf::Params::unpack(read32(payload + field + 4), kdf))
+                {
+                    return -1;
+                }
+
+                rLogins[url] = LoginData(url, user, read32(payload + field), kdf);
+            }
+            else if (payload[0] == REMOVE)
+            {
+                rLogins.remove(url);
+            }
+            else
+            {
+                break;
+            }
+
+            pos += 4 + size + 2;
+        }
+
+        return pos;
+    }
+
+    //! Read a snapshot to rLogins.
+    bool loadSnapshot(const QString & fileName, LoginHash & rLogins)
+    {
+        LoginCatalog catalog;
+        if (!catalog.open(fileName))
+        {
+            return false;
+        }
+
+        rLogins.reserve(catalog.count());
+
+        LoginData login;
+        for (int i = 0; i < catalog.count(); i++)
+        {
+            if (!catalog.at(i, login))
+            {
+                return false;
+            }
+
+            rLogins.insert(login.url(), login);
+        }
+
+        return true;
+    }
+
+    //! Thread folding the journals up to a generation into the snapshot of the next one.
+    class Compactor : public QThread
+    {
+    public:
+
+        Compactor(const QString & directory, int generation)
+        : m_directory(directory)
+        , m_generation(generation)
+        {}
+
+    protected:
+
+        //! \reimp
+        virtual void run()
+        {
+            // Start from the newest snapshot, which is older than the
+            // generation if a previous compaction failed. Without any
+            // snapshot the journals hold all of the logins.
+            const QList<int> snapshots = generations(m_directory, "snapshot");
+            const QList<int> journals  = generations(m_directory, "journal");
+
+            int first = -1;
+            for (int i = 0; i < snapshots.count() && snapshots.at(i) <= m_generation; i++)
+            {
+                first = snapshots.at(i);
+            }
+
+            LoginHash logins;
+            if (first >= 0 && !loadSnapshot(snapshotName(m_directory, first), logins))
+            {
+                return;
+            }
+
+            for (int i = 0; i < journals.count() && journals.at(i) <= m_generation; i++)
+            {
+                if (journals.at(i) >= first &&
+                    replayJournal(journalName(m_directory, journals.at(i)), logins) < 0)
+                {
+                    return;
+                }
+            }
+
+            // The old generations are needed until the new snapshot is in place
+            if (!LoginIO::exportCatalog(logins.values(), snapshotName(m_directory, m_generation + 1)))
+            {
+                return;
+            }
+
+            for (int i = 0; i < snapshots.count() && snapshots.at(i) <= m_generation; i++)
+            {
+                QFile::remove(snapshotName(m_directory, snapshots.at(i)));
+            }
+
+            for (int i = 0; i < journals.count() && journals.at(i) <= m_generation; i++)
+            {
+                QFile::remove(journalName(m_directory, journals.at(i)));
+            }
+        }
+
+    private:
+
+        QString m_directory;
+
+        int m_generation;
+    };
+}
+
+LoginStore::LoginStore(QString directory)
+: m_directory(directory)
+, m_generation(0)
+, m_compactSize(MIN_COMPACT_SIZE)
+, m_compactor(0)
+{}
+
+QString LoginStore::defaultDirectory()
+{
+    // The ini file name is a real path on every platform unlike the native one
+    const QSettings settings(QSettings::IniFormat, QSettings::UserScope,
+        Config::COMPANY, Config::SOFTWARE);
+    return QFileInfo(settings.fileName()).absolutePath() + "/logins";
+}
+
+const QString & LoginStore::directory() const
+{
+    return m_directory;
+}
+
+bool LoginStore::load(LoginIO::LoginList & rLogins)
+{
+    waitForCompaction();
+    m_journal.close();
+
+    if (!QDir().mkpath(m_directory))
+    {
+        return false;
+    }
+
+    const QList<int> snapshots = generations(m_directory, "snapshot");
+    const QList<int> journals  = generations(m_directory, "journal");
+    const int        first     = snapshots.isEmpty() ? 0 : snapshots.last();
+
+    // Without a snapshot the store is empty or all of it is in the journals
+    LoginHash logins;
+    if (!snapshots.isEmpty() && !loadSnapshot(snapshotName(m_directory, first), logins))
+    {
+        return false;
+    }
+
+    qint64 validSize = 0;
+    for (int i = 0; i < journals.count(); i++)
+    {
+        if (journals.at(i) >= first)
+        {
+            validSize = replayJournal(journalName(m_directory, journals.at(i)), logins);
+            if (validSize < 0)
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Left behind by an interrupted compaction
+            QFile::remove(journalName(m_directory, journals.at(i)));
+        }
+    }
+
+    for (int i = 0; i + 1 < snapshots.count(); i++)
+    {
+        QFile::remove(snapshotName(m_directory, snapshots.at(i)));
+    }
+
+    // Drop a record torn by a crash before appending to the journal
+    const QString lastJournal = journalName(m_directory,
+        journals.isEmpty() ? first : qMax(first, journals.last()));
+    if (QFileInfo(lastJournal).size() > validSize && !QFile::resize(lastJournal, validSize))
+    {
+        return false;
+    }
+
+    if (!openJournal(first, journals))
+    {
+        return false;
+    }
+
+    rLogins = logins.values();
+    return true;
+}
+
+QByteArray LoginStore::state()
+{
+    waitForCompaction();
+
+    const QFileInfoList files = QDir(m_directory).entryInfoList(
+        QStringList() << "snapshot.*" << "journal.*", QDir::Files, QDir::Name);
+
+    QByteArray state;
+    for (int i = 0; i < files.count(); i++)
+    {
+        state += QString("%1:%2:%3;")
+            .arg(files.at(i).fileName())
+            .arg(files.at(i).size())
+            .arg(files.at(i).lastModified().toMSecsSinceEpoch()).toUtf8();
+    }
+
+    return state;
+}
+
+bool LoginStore::open(const QByteArray & expected)
+{
+    // The journal is reopened unchanged, so the state stays the same
+    if (state() != expected)
+    {
+        return false;
+    }
+
+    m_journal.close();
+
+    const QList<int> snapshots = generations(m_directory, "snapshot");
+    return openJournal(snapshots.isEmpty() ? 0 : snapshots.last(),
+        generations(m_directory, "journal"));
+}
+
+bool LoginStore::openJournal(int firstGeneration, const QList<int> & journals)
+{
+    m_generation = journals.isEmpty() ? firstGeneration : qMax(firstGeneration, journals.last());
+
+    m_journal.setFileName(journalName(m_directory, m_generation));
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        return false;
+    }
+
+    m_compactSize = qMax(MIN_COMPACT_SIZE,
+        QFileInfo(snapshotName(m_directory, firstGeneration)).size());
+    return true;
+}
+
+bool LoginStore::save(const LoginData & login)
+{
+    QByteArray record;
+    appendRecord(record, SAVE, login);
+    return append(record);
+}
+
+bool LoginStore::save(const LoginIO::LoginList & logins)
+{
+    QByteArray records;
+    for (int i = 0; i < logins.count(); i++)
+    {
+        appendRecord(records, SAVE, logins.at(i));
+    }
+
+    return append(records);
+}
+
+bool LoginStore::remove(const QString & url)
+{
+    QByteArray record;
+    appendRecord(record, REMOVE, LoginData(url, "", 0));
+    return append(record);
+}
+
+bool LoginStore::update(const LoginIO::LoginList & saved, const QStringList & removed)
+{
+    QByteArray records;
+    for (int i = 0; i < saved.count(); i++)
+    {
+        appendRecord(records, SAVE, saved.at(i));
+    }
+
+    for (int i = 0; i < removed.count(); i++)
+    {
+        appendRecord(records, REMOVE, LoginData(removed.at(i), "", 0));
+    }
+
+    return append(records);
+}
+
+bool LoginStore::append(const QByteArray & records)
+{
+    if (!m_journal.isOpen())
+    {
+        return false;
+    }
+
+    // The records are durable only once the sync succeeds
+    const qint64 size = m_journal.size();
+    if (m_journal.write(records) != records.size() || !m_journal.flush() ||
+        !syncToDisk(m_journal))
+    {
+        // Don't leave a partial record for the next append to follow
+        m_journal.resize(size);
+        return false;
+    }
+
+    return m_journal.size() < m_compactSize || compact();
+}
+
+bool LoginStore::compact()
+{
+    // The journal keeps growing until the running compaction is done
+    if (m_compactor && m_compactor->isRunning())
+    {
+        return true;
+    }
+
+    delete m_compactor;
+    m_compactor = 0;
+
+    const qint64 size = QFileInfo(snapshotName(m_directory, m_generation)).size() + m_journal.size();
+
+    m_journal.close();
+    m_journal.setFileName(journalName(m_directory, m_generation + 1));
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        // Keep appending to the old generation
+        m_journal.setFileName(journalName(m_directory, m_generation));
+        return m_journal.open(QIODevice::WriteOnly | QIODevice::Append);
+    }
+
+    m_compactor = new Compactor(m_directory, m_generation++);
+    m_compactor->start(QThread::LowPriority);
+
+    // The next snapshot is at most as big as the old one and its journal
+    m_compactSize = qMax(MIN_COMPACT_SIZE, size);
+    return true;
+}
+
+void LoginStore::waitForCompaction()
+{
+    if (m_compactor)
+    {
+        m_compactor->wait();
+    }
+}
+
+LoginStore::~LoginStore()
+{
+    waitForCompaction();
+    delete m_compactor;
+}
@@ -0,0 +1,109 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef LOGINSTORE_H
+#define LOGINSTORE_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+
+#include "loginio.h"
+
+class QThread;
+
+//! Persistent set of logins keyed by url. Every change is appended to a
+//! journal as a single record, so saving a login costs the same no matter
+//! how many are stored. The journal is folded into a snapshot in a
+//! background thread when it grows as big as the snapshot.
+//!
+//! The store is a directory of generations. snapshot.N is a LoginCatalog
+//! holding the state before journal.N, and the state of the store is the
+//! newest snapshot followed by the journals of that and later generations.
+//! A compaction starts journal.N+1, writes snapshot.N+1 from the newest
+//! snapshot and the journals up to N, and only then removes the files of
+//! those generations, so the store survives a crash or a failed compaction
+//! at any point. A record torn by a crash is dropped on the next load.
+class LoginStore
+{
+public:
+
+    //! Constructor. The directory is created on load() if needed.
+    explicit LoginStore(QString directory);
+
+    //! Destructor. Waits for a running compaction.
+    ~LoginStore();
+
+    //! Default directory of the store, next to the settings.
+    static QString defaultDirectory();
+
+    //! Directory of the store.
+    const QString & directory() const;
+
+    //! Read all stored logins to rLogins and open the store for changes.
+    bool load(LoginIO::LoginList & rLogins);
+
+    //! Identify the stored logins by the names, sizes and modification
+    //! times of the files of the store. Any change to the logins changes
+    //! the state. Waits for a running compaction.
+    QByteArray state();
+
+    //! Open the store for changes without reading the logins, if its
+    //! state() is still the given one. The caller must already have
+    //! the logins of that state.
+    bool open(const QByteArray & state);
+
+    //! Add or update a login.
+    bool save(const LoginData & login);
+
+    //! Add or update several logins with one write.
+    bool save(const LoginIO::LoginList & logins);
+
+    //! Remove the login of the url.
+    bool remove(const QString & url);
+
+    //! Save and remove several logins with one write.
+    bool update(const LoginIO::LoginList & saved, const QStringList & removed);
+
+private:
+
+    //! Open the journal of the newest generation for appending.
+    bool openJournal(int firstGeneration, const QList<int> & journals);
+
+    //! Append encoded records to the journal and sync it to disk.
+    bool append(const QByteArray & records);
+
+    //! Start a new generation and compact the previous one in the background.
+    bool compact();
+
+    //! Wait for a running compaction.
+    void waitForCompaction();
+
+    QString m_directory;
+
+    //! Current generation.
+    int m_generation;
+
+    //! Journal of the current generation.
+    QFile m_journal;
+
+    //! Journal size that triggers a compaction.
+    qint64 m_compactSize;
+
+    QThread * m_compactor;
+};
+
+#endif // LOGINSTORE_H
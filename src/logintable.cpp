@@ -0,0 +1,439 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "logintable.h"
+
+#include <cstring>
+
+namespace
+{
+    //! Garbage in the arena is collected when there's at least this much.
+    const int MIN_GARBAGE = 4096;
+
+    //! FNV-1a over the code units, finished with the MurmurHash3 mixer
+    //! so that all bits depend on all units. Latin-1 and UTF-16 forms
+    //! of the same url get the same hash.
+    template <typename T>
+    quint32 hashUnits(const T * data, int size)
+    {
+        quint32 hash = 2166136261u;
+        for (int i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    //! Compare the code units of two urls of the same size.
+    template <typename T>
+    bool equalUnits(const ushort * a, const T * b, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            if (a[i] != b[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    void appendValue(QByteArray & rOut, T value)
+    {
+        rOut.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    void appendArray(QByteArray & rOut, const QVector<T> & values)
+    {
+        rOut.append(reinterpret_cast<const char *>(values.constData()), values.count() * sizeof(T));
+    }
+
+    template <typename T>
+    bool readArray(const char * data, int size, int & rPos, quint32 count, QVector<T> & rValues)
+    {
+        if (static_cast<qint64>(count) * sizeof(T) > static_cast<quint64>(size - rPos))
+        {
+            return false;
+        }
+
+        rValues.resize(count);
+        std::memcpy(rValues.data(), data + rPos, count * sizeof(T));
+        rPos += count * sizeof(T);
+        return true;
+    }
+
+    template <typename T>
+    bool readValue(const char * data, int size, int & rPos, T & rValue)
+    {
+        if (size - rPos < static_cast<int>(sizeof(T)))
+        {
+            return false;
+        }
+
+        std::memcpy(&rValue, data + rPos, sizeof(T));
+        rPos += sizeof(T);
+        return true;
+    }
+
+    //! UTF-16 is compared as bytes.
+    bool equalUnits(const ushort * a, const ushort * b, int size)
+    {
+        return std::memcmp(a, b, size * sizeof(ushort)) == 0;
+    }
+}
+
+LoginTable::Login::Login(const LoginTable & table, int row)
+: m_table(&table)
+, m_row(row)
+{}
+
+QString LoginTable::Login::url() const
+{
+    return QString(
+        reinterpret_cast<const QChar *>(m_table->m_chars.constData() + m_table->m_urlOffsets.at(m_row)),
+        m_table->m_urlSizes.at(m_row));
+}
+
+const QString & LoginTable::Login::userName() const
+{
+    return m_table->m_users.at(m_table->m_userIds.at(m_row));
+}
+
+int LoginTable::Login::passwordLength() const
+{
+    return m_table->m_lengths.at(m_row);
+}
+
+Kdf::Params LoginTable::Login::kdf() const
+{
+    // Only valid words are stored, readImage() rejects the others
+    Kdf::Params kdf;
+    Kdf::Params::unpack(m_table->m_kdfs.at(m_row), kdf);
+    return kdf;
+}
+
+LoginData LoginTable::Login::toLoginData() const
+{
+    return LoginData(url(), userName(), passwordLength(), kdf());
+}
+
+LoginTable::LoginTable()
+: m_garbage(0)
+{}
+
+int LoginTable::count() const
+{
+    return m_hashes.count();
+}
+
+void LoginTable::reserve(int count)
+{
+    m_urlOffsets.reserve(count);
+    m_urlSizes.reserve(count);
+    m_userIds.reserve(count);
+    m_kdfs.reserve(count);
+    m_lengths.reserve(count);
+    m_hashes.reserve(count);
+
+    if (count > this->count())
+    {
+        m_index.rebuild(m_hashes, count);
+    }
+}
+
+void LoginTable::clear()
+{
+    *this = LoginTable();
+}
+
+void LoginTable::insert(const LoginData & login)
+{
+    const QString url = login.url();
+    const quint16 length = qBound(0, login.passwordLength(), 0xffff);
+
+    const int row = find(url);
+    if (row >= 0)
+    {
+        m_userIds[row] = internUser(login.userName());
+        m_kdfs[row]    = login.kdf().pack();
+        m_lengths[row] = length;
+        return;
+    }
+
+    if (m_index.isFull())
+    {
+        m_index.rebuild(m_hashes, (count() + 1) * 2);
+    }
+
+    const int offset = m_chars.count();
+    m_chars.resize(offset + url.size());
+    std::memcpy(m_chars.data() + offset, url.utf16(), url.size() * sizeof(ushort));
+
+    m_urlOffsets << offset;
+    m_urlSizes   << url.size();
+    m_userIds    << internUser(login.userName());
+    m_kdfs       << login.kdf().pack();
+    m_lengths    << length;
+    m_hashes     << hashUnits(url.utf16(), url.size());
+
+    m_index.insert(m_hashes.last(), count() - 1);
+}
+
+bool LoginTable::remove(const QString & url)
+{
+    const int row = find(url);
+    if (row < 0)
+    {
+        return false;
+    }
+
+    m_index.remove(m_hashes.at(row), row);
+    m_garbage += m_urlSizes.at(row);
+
+    // Move the last login to the freed row
+    const int last = count() - 1;
+    if (row != last)
+    {
+        m_index.move(m_hashes.at(last), last, row);
+
+        m_urlOffsets[row] = m_urlOffsets.at(last);
+        m_urlSizes[row]   = m_urlSizes.at(last);
+        m_userIds[row]    = m_userIds.at(last);
+        m_kdfs[row]       = m_kdfs.at(last);
+        m_lengths[row]    = m_lengths.at(last);
+        m_hashes[row]     = m_hashes.at(last);
+    }
+
+    m_urlOffsets.resize(last);
+    m_urlSizes.resize(last);
+    m_userIds.resize(last);
+    m_kdfs.resize(last);
+    m_lengths.resize(last);
+    m_hashes.resize(last);
+
+    if (m_garbage >= MIN_GARBAGE && m_garbage > m_chars.count() / 2)
+    {
+        compactArena();
+    }
+
+    return true;
+}
+
+int LoginTable::find(const QString & url) const
+{
+    return findUnits(url.utf16(), url.size());
+}
+
+int LoginTable::find(const ushort * url, int size) const
+{
+    return findUnits(url, size);
+}
+
+int LoginTable::findLatin1(const char * url, int size) const
+{
+    return findUnits(reinterpret_cast<const uchar *>(url), size);
+}
+
+template <typename T>
+int LoginTable::findUnits(const T * url, int size) const
+{
+    const quint32 hash = hashUnits(url, size);
+
+    // Most urls typed in the window are not saved
+    if (!m_index.mayContain(hash))
+    {
+        return -1;
+    }
+
+    return m_index.find(hash, [&](int row)
+    {
+        return m_hashes.at(row) == hash && m_urlSizes.at(row) == static_cast<quint32>(size) &&
+            equalUnits(m_chars.constData() + m_urlOffsets.at(row), url, size);
+    });
+}
+
+bool LoginTable::contains(const QString & url) const
+{
+    return find(url) >= 0;
+}
+
+LoginTable::Login LoginTable::at(int row) const
+{
+    return Login(*this, row);
+}
+
+QStringList LoginTable::urls() const
+{
+    QStringList urls;
+    urls.reserve(count());
+    for (int row = 0; row < count(); row++)
+    {
+        urls << at(row).url();
+    }
+
+    return urls;
+}
+
+qint64 LoginTable::memoryUsage() const
+{
+    qint64 bytes =
+        static_cast<qint64>(m_chars.capacity()) * sizeof(ushort) +
+        static_cast<qint64>(m_urlOffsets.capacity() + m_urlSizes.capacity() +
+            m_userIds.capacity() + m_kdfs.capacity() + m_hashes.capacity()) * sizeof(quint32) +
+        static_cast<qint64>(m_lengths.capacity()) * sizeof(quint16) +
+        m_index.memoryUsage();
+
+    // The user names are shared by the list and the hash keys
+    for (int i = 0; i < m_users.count(); i++)
+    {
+        bytes += m_users.at(i).capacity() * sizeof(QChar) + sizeof(QString) * 2;
+    }
+
+    return bytes;
+}
+
+quint32 LoginTable::internUser(const QString & userName)
+{
+    const QHash<QString, quint32>::const_iterator i = m_userIdsByName.constFind(userName);
+    if (i != m_userIdsByName.constEnd())
+    {
+        return i.value();
+    }
+
+    const quint32 id = m_users.count();
+    m_users << userName;
+    m_userIdsByName.insert(userName, id);
+    return id;
+}
+
+void LoginTable::compactArena()
+{
+    QVector<ushort> chars(m_chars.count() - m_garbage);
+
+    int offset = 0;
+    for (int row = 0; row < count(); row++)
+    {
+        std::memcpy(chars.data() + offset, m_chars.constData() + m_urlOffsets.at(row),
+            m_urlSizes.at(row) * sizeof(ushort));
+        m_urlOffsets[row] = offset;
+        offset += m_urlSizes.at(row);
+    }
+
+    m_chars   = chars;
+    m_garbage = 0;
+}
+
+void LoginTable::writeImage(QByteArray & rImage) const
+{
+    appendValue<quint32>(rImage, count());
+    appendValue<quint32>(rImage, m_chars.count());
+    appendValue<quint32>(rImage, m_users.count());
+
+    for (int i = 0; i < m_users.count(); i++)
+    {
+        appendValue<quint32>(rImage, m_users.at(i).size());
+        rImage.append(reinterpret_cast<const char *>(m_users.at(i).utf16()),
+            m_users.at(i).size() * sizeof(ushort));
+    }
+
+    appendArray(rImage, m_chars);
+    appendArray(rImage, m_urlOffsets);
+    appendArray(rImage, m_urlSizes);
+    appendArray(rImage, m_userIds);
+    appendArray(rImage, m_kdfs);
+    appendArray(rImage, m_hashes);
+    appendArray(rImage, m_lengths);
+}
+
+bool LoginTable::readImage(const char * data, int size, int & rPos)
+{
+    clear();
+
+    quint32 rows  = 0;
+    quint32 chars = 0;
+    quint32 users = 0;
+    if (!readValue(data, size, rPos, rows) ||
+        !readValue(data, size, rPos, chars) ||
+        !readValue(data, size, rPos, users))
+    {
+        return false;
+    }
+
+    QVector<ushort> userChars;
+    for (quint32 i = 0; i < users; i++)
+    {
+        quint32 userSize = 0;
+        if (!readValue(data, size, rPos, userSize) ||
+            !readArray(data, size, rPos, userSize, userChars))
+        {
+            clear();
+            return false;
+        }
+
+        internUser(QString(reinterpret_cast<const QChar *>(userChars.constData()), userSize));
+    }
+
+    if (static_cast<quint32>(m_users.count()) != users ||
+        !readArray(data, size, rPos, chars, m_chars) ||
+        !readArray(data, size, rPos, rows, m_urlOffsets) ||
+        !readArray(data, size, rPos, rows, m_urlSizes) ||
+        !readArray(data, size, rPos, rows, m_userIds) ||
+        !readArray(data, size, rPos, rows, m_kdfs) ||
+        !readArray(data, size, rPos, rows, m_hashes) ||
+        !readArray(data, size, rPos, rows, m_lengths))
+    {
+        clear();
+        return false;
+    }
+
+    // The urls must stay in the arena, the user ids in the list and
+    // the key derivations known to this version
+    qint64 used = 0;
+    Kdf::Params kdf;
+    for (quint32 row = 0; row < rows; row++)
+    {
+        if (static_cast<qint64>(m_urlOffsets.at(row)) + m_urlSizes.at(row) > chars ||
+            m_userIds.at(row) >= users ||
+            !Kdf::Params::unpack(m_kdfs.at(row), kdf))
+        {
+            clear();
+            return false;
+        }
+
+        used += m_urlSizes.at(row);
+    }
+
+    if (used > chars)
+    {
+        clear();
+        return false;
+    }
+
+    m_garbage = chars - used;
+
+    // The stored hashes spare hashing the urls again
+    m_index.rebuild(m_hashes, rows);
+    return true;
+}
@@ -0,0 +1,159 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef LOGINTABLE_H
+#define LOGINTABLE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "logindata.h"
+#include "urlindex.h"
+
+//! Compact in-memory set of logins keyed by url.
+//!
+//! The urls are stored once as UTF-16 in a single character arena and
+//! the user names are interned, since most logins share a few service
+//! accounts. The per-login fields are kept in parallel arrays of 32-bit
+//! offsets and ids, and a UrlIndex finds the login of an url. Urls can
+//! be looked up as UTF-16 or Latin-1 without building a QString. Rows
+//! are not stable: removing a login moves the last one to its place.
+//!
+//! Copies are cheap until modified, like those of the Qt containers.
+class LoginTable
+{
+public:
+
+    //! Lightweight view of a login in the table. Valid until the
+    //! table is modified.
+    class Login
+    {
+    public:
+
+        //! Get URL/ID.
+        QString url() const;
+
+        //! Get user name.
+        const QString & userName() const;
+
+        //! Get password length.
+        int passwordLength() const;
+
+        //! Get key derivation.
+        Kdf::Params kdf() const;
+
+        //! Copy to a LoginData.
+        LoginData toLoginData() const;
+
+    private:
+
+        friend class LoginTable;
+
+        Login(const LoginTable & table, int row);
+
+        const LoginTable * m_table;
+
+        int m_row;
+    };
+
+    //! Constructor.
+    LoginTable();
+
+    //! Number of logins.
+    int count() const;
+
+    //! Reserve space for count logins.
+    void reserve(int count);
+
+    //! Remove all logins.
+    void clear();
+
+    //! Add a login or replace the login of the same url.
+    void insert(const LoginData & login);
+
+    //! Remove the login of the url. Return false if it wasn't there.
+    bool remove(const QString & url);
+
+    //! Return the row of the login of the url, or -1.
+    int find(const QString & url) const;
+
+    //! Return the row of the url given as UTF-16, or -1.
+    int find(const ushort * url, int size) const;
+
+    //! Return the row of the url given as Latin-1, or -1.
+    int findLatin1(const char * url, int size) const;
+
+    //! Return true if there's a login for the url.
+    bool contains(const QString & url) const;
+
+    //! Login at the given row, 0 <= row < count().
+    Login at(int row) const;
+
+    //! Urls of all logins in row order.
+    QStringList urls() const;
+
+    //! Approximate number of bytes allocated by the table.
+    qint64 memoryUsage() const;
+
+    //! Append an image of the table to rImage. The image is the arrays
+    //! of the table in the byte order of the machine, so that reading it
+    //! back is little more than a copy.
+    void writeImage(QByteArray & rImage) const;
+
+    //! Replace the table with an image written by writeImage(), starting
+    //! at rPos of the data. Advance rPos past the image. Return false and
+    //! leave the table empty if the image is invalid.
+    bool readImage(const char * data, int size, int & rPos);
+
+private:
+
+    //! Find the url given as code units of type T.
+    template <typename T>
+    int findUnits(const T * url, int size) const;
+
+    //! Return the id of the user name, adding it if new.
+    quint32 internUser(const QString & userName);
+
+    //! Drop the characters of removed urls from the arena.
+    void compactArena();
+
+    //! UTF-16 characters of the urls.
+    QVector<ushort> m_chars;
+
+    //! Characters of the removed urls still in the arena.
+    int m_garbage;
+
+    //! Per login: url position in the arena, url size, user id, packed
+    //! key derivation, password length and url hash.
+    QVector<quint32> m_urlOffsets;
+    QVector<quint32> m_urlSizes;
+    QVector<quint32> m_userIds;
+    QVector<quint32> m_kdfs;
+    QVector<quint16> m_lengths;
+    QVector<quint32> m_hashes;
+
+    //! Index from the url hashes to the rows.
+    UrlIndex m_index;
+
+    //! Interned user names and their ids.
+    QVector<QString> m_users;
+    QHash<QString, quint32> m_userIdsByName;
+};
+
+#endif // LOGINTABLE_H
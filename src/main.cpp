@@ -14,19 +14,69 @@
 // along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
 //
 #include <QApplication>
+#include <QScopedPointer>
+#include <QString>
+
+#include <cstring>
 
 #include "mainwindow.h"
+#include "trace.h"
+
+namespace
+{
+    //! Name of the trace file given by --trace FILE or the
+    //! FLEETINGPM_TRACE environment variable, empty if none.
+    QString traceFileName(int argc, char ** argv)
+    {
+        for (int i = 1; i + 1 < argc; i++)
+        {
+            if (std::strcmp(argv[i], "--trace") == 0)
+            {
+                return QString::fromLocal8Bit(argv[i + 1]);
+            }
+        }
+
+        return QString::fromLocal8Bit(qgetenv("FLEETINGPM_TRACE"));
+    }
+}
 
 int main(int argc, char ** argv)
 {
-    QApplication app(argc, argv);
-    MainWindow mainWindow;
+    const QString traceFile = traceFileName(argc, argv);
+    if (!traceFile.isEmpty())
+    {
+        Trace::start(traceFile);
+    }
+
+    int result = 0;
+    {
+        TRACE_SPAN("main");
+
+        QScopedPointer<QApplication> app;
+        {
+            TRACE_SPAN("QApplication::QApplication");
+            app.reset(new QApplication(argc, argv));
+        }
+
+        QScopedPointer<MainWindow> mainWindow;
+        {
+            TRACE_SPAN("MainWindow::MainWindow");
+            mainWindow.reset(new MainWindow);
+        }
+
+        {
+            TRACE_SPAN("MainWindow::show");
 
 #ifdef __ANDROID__
-    mainWindow.showFullScreen();
+            mainWindow->showFullScreen();
 #else
-    mainWindow.show();
+            mainWindow->show();
 #endif
+        }
+
+        result = app->exec();
+    }
 
-    return app.exec();
+    Trace::finish();
+    return result;
 }
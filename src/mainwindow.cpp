@@ -17,10 +17,18 @@
 #include "aboutdlg.h"
 #include "config.h"
 #include "engine.h"
+#include "fadinglineedit.h"
+#include "importworker.h"
 #include "instructionsdlg.h"
 #include "loginio.h"
+#include "loginstore.h"
 #include "mainwindow.h"
 #include "settingsdlg.h"
+#include "startupcache.h"
+#include "storeworker.h"
+#include "trace.h"
+#include "urlcompleter.h"
+#include "urllistmodel.h"
 
 #include <QAction>
 #include <QApplication>
@@ -34,14 +42,63 @@
 #include <QIcon>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListView>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QPaintEvent>
+#include <QProgressDialog>
 #include <QPushButton>
+#include <QScopedPointer>
 #include <QSettings>
 #include <QSpinBox>
-#include <QTimeLine>
+#include <QStringList>
+#include <QThread>
 #include <QTimer>
+#include <QVector>
+
+namespace
+{
+    //! Master passwords at least this long are shown in green.
+    const int GOOD_MASTER_LENGTH = 8;
+
+    //! Generating a password of a new login takes about this long
+    //! with the key derivation chosen in the settings.
+    const int KDF_TARGET_MS = 250;
+
+    //! The startup cache is written once the saved logins have stayed
+    //! unchanged this long, so that a burst of changes writes it once.
+    const int CACHE_DELAY_MS = 5000;
+
+    //! Fits the cost of a key derivation to this machine in a background
+    //! thread, since it takes about twice KDF_TARGET_MS.
+    class KdfCalibration : public QThread
+    {
+    public:
+
+        explicit KdfCalibration(Kdf::Algorithm algorithm)
+        : m_params(algorithm, 0)
+        {}
+
+        //! Algorithm and the calibrated cost. Valid when finished.
+        const Kdf::Params & params() const
+        {
+            return m_params;
+        }
+
+    protected:
+
+        //! \reimp
+        virtual void run()
+        {
+            m_params = Kdf::calibrate(m_params.algorithm, KDF_TARGET_MS);
+        }
+
+    private:
+
+        Kdf::Params m_params;
+    };
+}
 
 MainWindow::MainWindow(QWidget *parent)
 : QMainWindow(parent)
@@ -61,34 +118,62 @@ MainWindow::MainWindow(QWidget *parent)
 , m_masterEdit(new QLineEdit(this))
 , m_masterLabel(new QLabel(this))
 , m_userEdit(new QLineEdit(this))
-, m_passwdEdit(new QLineEdit(this))
+, m_passwdEdit(new FadingLineEdit(this))
 , m_urlCombo(new QComboBox(this))
+, m_urlModel(new UrlListModel(this))
 , m_genButton(new QPushButton(tr("&Show password!"), this))
 , m_saveButton(new QPushButton(m_saveText, this))
 , m_lengthSpinBox(new QSpinBox(this))
 , m_masterTimer(new QTimer)
-, m_timeLine(new QTimeLine)
-, m_settingsDlg(new SettingsDlg(this))
+, m_master(0)
+, m_settingsDlg(0)
+, m_loginStore(new LoginStore(LoginStore::defaultDirectory()))
+, m_startupCache(new StartupCache(LoginStore::defaultDirectory() + "/startup.cache"))
+, m_cacheTimer(new QTimer(this))
+, m_storeWorker(0)
+, m_importWorker(0)
+, m_importProgress(0)
+, m_kdfCalibration(0)
+, m_inputTimer(new QTimer(this))
+, m_changedInputs(0)
+, m_background(":/back.png")
 {
     setWindowTitle("Fleeting Password Manager");
     setWindowIcon(QIcon(":/fleetingpm.png"));
 
+    // Inputs changed during the same event loop turn are
+    // evaluated together when the loop gets idle.
+    m_inputTimer->setInterval(0);
+    m_inputTimer->setSingleShot(true);
+    connect(m_inputTimer, SIGNAL(timeout()), this, SLOT(updateInputState()));
+
+    // Keep the startup cache up to date in case the app doesn't exit cleanly
+    m_cacheTimer->setInterval(CACHE_DELAY_MS);
+    m_cacheTimer->setSingleShot(true);
+    connect(m_cacheTimer, SIGNAL(timeout()), this, SLOT(writeStartupCache()));
+
     initWidgets();
     initMenu();
     initBackground();
+
+    {
+        TRACE_SPAN("SettingsDlg::SettingsDlg");
+        m_settingsDlg = new SettingsDlg(this);
+    }
+
     loadSettings();
 
+    // Changes to the logins are written in the background from now on
+    m_storeWorker = new StoreWorker(*m_loginStore);
+
     // Apply window flags
     if (m_alwaysOnTop)
     {
         setWindowFlags(windowFlags() | Qt::WindowStaysOnTopHint);
     }
 
-    // Initialize the timer used when fading out the login details.
-    m_timeLine->setDuration(m_loginDelay * 1000);
-    connect(m_timeLine, SIGNAL(frameChanged(int)), this, SLOT(decreasePasswordAlpha(int)));
-    connect(m_timeLine, SIGNAL(finished()), this, SLOT(invalidateAll()));
-    m_timeLine->setFrameRange(0, 255);
+    // The login details are cleared when the password has faded out.
+    connect(m_passwdEdit, SIGNAL(fadeFinished()), this, SLOT(invalidateAll()));
 
     // Initialize the timer used when showing the
     // master password.
@@ -105,6 +190,8 @@ MainWindow::MainWindow(QWidget *parent)
 
 void MainWindow::centerOrRestoreLocation()
 {
+    TRACE_SPAN("MainWindow::centerOrRestoreLocation");
+
     // Calculate center coordinates
     QRect geom(QApplication::desktop()->availableGeometry());
     const int centerX = geom.width()  / 2 - frameGeometry().width()  / 2;
@@ -128,11 +215,17 @@ void MainWindow::centerOrRestoreLocation()
 
 void MainWindow::initBackground()
 {
-    setStyleSheet("MainWindow { background-image: url(:/back.png) }");
+    TRACE_SPAN("MainWindow::initBackground");
+
+    // paintEvent() covers the whole window, so Qt doesn't need to
+    // clear it first
+    setAttribute(Qt::WA_OpaquePaintEvent);
 }
 
 void MainWindow::initWidgets()
 {
+    TRACE_SPAN("MainWindow::initWidgets");
+
     // Create main layout as a grid layout
     // No need to store as a member.
     QGridLayout * layout = new QGridLayout();
@@ -161,6 +254,24 @@ void MainWindow::initWidgets()
     // Make the URL combo box editable
     m_urlCombo->setEditable(true);
 
+    // Back the URL combo box with the sorted model. All rows of the
+    // popup have the same height, so only the visible ones are laid out.
+    QListView * urlView = new QListView(m_urlCombo);
+    urlView->setUniformItemSizes(true);
+    m_urlCombo->setView(urlView);
+    m_urlCombo->setModel(m_urlModel);
+    m_urlCombo->setInsertPolicy(QComboBox::NoInsert);
+    m_urlCombo->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLength);
+
+    // Complete the typed url from the saved ones
+    UrlCompleter * completer = new UrlCompleter(*m_urlModel, m_urlCombo);
+    m_urlCombo->setCompleter(completer);
+
+    // QLineEdit emits textEdited() before it asks the completer to
+    // complete, so the completions are refilled in time
+    connect(m_urlCombo->lineEdit(), SIGNAL(textEdited(const QString &)),
+        completer, SLOT(updateCompletions(const QString &)));
+
     // Set tooltip for the URL combo box
     m_urlCombo->setToolTip(tr("Enter or select a saved URL/ID.\n"
                               "For example \"facebook\", \"google\","
@@ -212,7 +323,7 @@ void MainWindow::initWidgets()
 
     // Add the "master password:"-label to the layout
     m_masterLabel->setText(m_masterPasswordText);
-    setMasterPasswordLabelColor();
+    setMasterPasswordLabelColor(0);
     layout->addWidget(m_masterLabel, 0, 0);
 
     // Create and add the "URL/ID:"-label to the layout
@@ -244,64 +355,32 @@ void MainWindow::initWidgets()
 
 void MainWindow::connectSignalsFromWidgets()
 {
-    // Connect signal to update user name field when a URL gets
-    // selected in the combo box
-    connect(m_urlCombo, SIGNAL(activated(const QString &)),
-        this, SLOT(updateUser(const QString &)));
-
-    // Decide the text of the save/remove-button if URL is changed
+    // Every input has a single connection. The state of the other
+    // widgets is derived from all of them in updateInputState().
+    connect(m_masterEdit, SIGNAL(textChanged(const QString &)),
+        this, SLOT(masterChanged()));
     connect(m_urlCombo, SIGNAL(editTextChanged(const QString &)),
-        this, SLOT(toggleSaveButtonText()));
-
-    // Decide the text of the save/remove-button if user name is changed
+        this, SLOT(urlChanged()));
     connect(m_userEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(toggleSaveButtonText()));
-
-    // Decide the text of the save/remove-button if length is changed
+        this, SLOT(userChanged()));
     connect(m_lengthSpinBox, SIGNAL(valueChanged(int)),
-        this, SLOT(toggleSaveButtonText()));
+        this, SLOT(lengthChanged()));
 
-    // Connect signal to update user name field if URL-field is changed
-    connect(m_urlCombo, SIGNAL(editTextChanged(const QString &)),
-        this, SLOT(updateUser(const QString &)));
+    // Selecting the current url again restores its saved user name
+    connect(m_urlCombo, SIGNAL(activated(const QString &)),
+        this, SLOT(urlChanged()));
 
     // Save of remove a saved login when save/remove-button is clicked
     connect(m_saveButton, SIGNAL(clicked()), this, SLOT(saveOrRemoveLogin()));
 
     // Generate the password when generate-button is clicked
     connect(m_genButton, SIGNAL(clicked()), this, SLOT(doGenerate()));
-
-    // Invalidate generated password if one of the inputs gets changed
-    connect(m_masterEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(invalidate()));
-    connect(m_urlCombo, SIGNAL(editTextChanged(const QString &)),
-        this, SLOT(invalidate()));
-    connect(m_userEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(invalidate()));
-
-    // Enable generate-button if all inputs are valid
-    connect(m_masterEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(enableGenButton()));
-    connect(m_urlCombo, SIGNAL(editTextChanged(const QString &)),
-        this, SLOT(enableGenButton()));
-    connect(m_userEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(enableGenButton()));
-
-    // Enable save-button if the URL not already saved
-    connect(m_masterEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(enableSaveButton()));
-    connect(m_urlCombo, SIGNAL(editTextChanged(const QString &)),
-        this, SLOT(enableSaveButton()));
-    connect(m_userEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(enableSaveButton()));
-
-    // Set "master password"-label color
-    connect(m_masterEdit, SIGNAL(textChanged(const QString &)),
-        this, SLOT(setMasterPasswordLabelColor()));
 }
 
 void MainWindow::initMenu()
 {
+    TRACE_SPAN("MainWindow::initMenu");
+
     // Add file menu
     QMenu * fileMenu = menuBar()->addMenu(tr("&File"));
 
@@ -347,67 +426,167 @@ void MainWindow::initMenu()
 
 void MainWindow::showSettingsDlg()
 {
+    // Show the algorithm being calibrated as the chosen one
+    const Kdf::Algorithm current = m_kdfCalibration ?
+        static_cast<KdfCalibration *>(m_kdfCalibration)->params().algorithm : m_kdf.algorithm;
+
     m_settingsDlg->setSettings(m_masterDelay,
-        m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop);
+        m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop, current);
     if (m_settingsDlg->exec() == QDialog::Accepted)
     {
+        Kdf::Algorithm kdf = Kdf::LEGACY_MD5;
         m_settingsDlg->getSettings(m_masterDelay,
-            m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop);
-        m_timeLine->setDuration(m_loginDelay * 1000);
+            m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop, kdf);
         m_masterTimer->setInterval(m_masterDelay * 60 * 1000);
         saveSettings();
+
+        // The cost is fitted to this machine once, when the algorithm
+        // is chosen. Logins keep the cost they were saved with. New
+        // logins use the previous derivation until the calibration is done.
+        if (kdf != current)
+        {
+            if (m_kdfCalibration)
+            {
+                // Rare, a calibration takes about half a second
+                m_kdfCalibration->wait();
+                delete m_kdfCalibration;
+            }
+
+            m_kdfCalibration = new KdfCalibration(kdf);
+            connect(m_kdfCalibration, SIGNAL(finished()), this, SLOT(finishKdfCalibration()));
+            setCursor(Qt::BusyCursor);
+            m_kdfCalibration->start(QThread::LowPriority);
+        }
     }
 }
 
+void MainWindow::finishKdfCalibration()
+{
+    if (!m_kdfCalibration || !m_kdfCalibration->isFinished())
+    {
+        return;
+    }
+
+    QScopedPointer<KdfCalibration> calibration(static_cast<KdfCalibration *>(m_kdfCalibration));
+    m_kdfCalibration = 0;
+
+    unsetCursor();
+
+    m_kdf = calibration->params();
+    saveSettings();
+}
+
 void MainWindow::importLogins()
 {
     const QString fileName = QFileDialog::getOpenFileName(this,
         tr("Import logins"), QDir::homePath(),
-        tr("Fleeting Password Manager files (*.fpm)"));
+        tr("Fleeting Password Manager files (*.fpm *.fpmc)"));
 
-    if (fileName.length() > 0)
+    if (fileName.length() > 0 && !m_importWorker)
+    {
+        TRACE_SPAN("MainWindow::importLogins");
+
+        // The file is read and compared to the current logins in the
+        // background, only the changes are applied here
+        m_importWorker = new ImportWorker(fileName, m_logins);
+        connect(m_importWorker, SIGNAL(finished()), this, SLOT(finishImport()));
+
+        m_importProgress = new QProgressDialog(tr("Importing logins from '") +
+            fileName + "'..", tr("Cancel"), 0, ImportWorker::PROGRESS_MAX, this);
+        m_importProgress->setWindowModality(Qt::WindowModal);
+        m_importProgress->setAutoClose(false);
+        m_importProgress->setAutoReset(false);
+        m_importProgress->setMinimumDuration(500);
+        connect(m_importProgress, SIGNAL(canceled()), this, SLOT(cancelImport()));
+
+        QTimer * progressTimer = new QTimer(m_importProgress);
+        progressTimer->setInterval(100);
+        connect(progressTimer, SIGNAL(timeout()), this, SLOT(updateImportProgress()));
+        progressTimer->start();
+
+        m_importWorker->start();
+    }
+}
+
+void MainWindow::updateImportProgress()
+{
+    if (m_importWorker && m_importProgress)
     {
-        int newLogins = 0;
-        int updated   = 0;
+        m_importProgress->setValue(m_importWorker->progress());
+    }
+}
 
-        LoginIO::LoginList logins;
-        if (LoginIO::importLogins(logins, fileName))
+void MainWindow::cancelImport()
+{
+    if (m_importWorker)
+    {
+        m_importWorker->cancel();
+    }
+}
+
+void MainWindow::finishImport()
+{
+    if (!m_importWorker)
+    {
+        return;
+    }
+
+    QScopedPointer<ImportWorker> worker(m_importWorker);
+    m_importWorker = 0;
+
+    const QString fileName = worker->fileName();
+
+    delete m_importProgress;
+    m_importProgress = 0;
+
+    if (worker->isCanceled())
+    {
+        return;
+    }
+
+    if (!worker->ok())
+    {
+        QMessageBox::warning(this, tr("Importing logins failed"),
+            tr("Failed to import logins from '") + fileName + "'");
+        return;
+    }
+
+    // The new urls are merged to the sorted url list in one pass
+    const LoginIO::LoginList & changes = worker->changes();
+
+    QStringList newUrls;
+    {
+        TRACE_SPAN("MainWindow::finishImport");
+
+        for (int i = 0; i < changes.count(); i++)
         {
-            for (int i = 0; i < logins.count(); i++)
+            const QString url = changes.at(i).url();
+            if (!m_logins.contains(url))
             {
-                const QString url    = logins.at(i).url();
-                const QString user   = logins.at(i).userName();
-                const int     length = logins.at(i).passwordLength();
-
-                if (m_loginHash.contains(url))
-                {
-                    updated++;
-                }
-                else
-                {
-                    m_urlCombo->addItem(url);
-                    newLogins++;
-                }
-
-                m_loginHash[url] = LoginData(url, user, length);
+                newUrls << url;
             }
 
-            m_urlCombo->model()->sort(0);
-            m_urlCombo->setCurrentIndex(0);
-            saveSettings();
-
-            QString message(tr("Successfully imported logins from '") +
-                fileName + tr("': %1 new, %2 updated."));
-            message = message.arg(newLogins).arg(updated);
-            QMessageBox::information(this, tr("Importing logins succeeded"),
-                message);
-        }
-        else
-        {
-            QMessageBox::warning(this, tr("Exporting logins failed"),
-                tr("Failed to import logins from '") + fileName + "'");
+            m_logins.insert(changes.at(i));
         }
+
+        m_urlModel->addUrls(newUrls);
+        m_urlCombo->setCurrentIndex(0);
+
+        // The current url may have been imported
+        scheduleInputUpdate(0);
+
+        // Identical logins are not written again
+        m_storeWorker->save(changes);
+        m_cacheTimer->start();
     }
+
+    QString message(tr("Successfully imported logins from '") +
+        fileName + tr("': %1 new, %2 updated, %3 unchanged."));
+    message = message.arg(newUrls.count())
+        .arg(changes.count() - newUrls.count())
+        .arg(worker->unchangedCount());
+    QMessageBox::information(this, tr("Importing logins succeeded"),
+        message);
 }
 
 void MainWindow::exportLogins()
@@ -421,7 +600,22 @@ void MainWindow::exportLogins()
         if (!fileName.endsWith(".fpm"))
             fileName.append(".fpm");
 
-        if (LoginIO::exportLogins(m_loginHash.values(), fileName))
+        // Stream the logins straight from the table
+        bool ok = false;
+        {
+            TRACE_SPAN("MainWindow::exportLogins");
+
+            LoginIO::LoginWriter writer;
+            ok = writer.open(fileName);
+            for (int i = 0; ok && i < m_logins.count(); i++)
+            {
+                ok = writer.write(m_logins.at(i).toLoginData());
+            }
+
+            ok = ok && writer.commit();
+        }
+
+        if (ok)
         {
             QMessageBox::information(this, tr("Exporting logins succeeded"),
                 tr("Successfully exported logins to '") + fileName + "'");
@@ -453,6 +647,8 @@ void MainWindow::showAboutQtDlg()
 
 void MainWindow::loadSettings()
 {
+    TRACE_SPAN("MainWindow::loadSettings");
+
     QSettings s(Config::COMPANY, Config::SOFTWARE);
 
     m_masterDelay = s.value("masterDelay", m_defaultMasterDelay).toInt();
@@ -461,43 +657,92 @@ void MainWindow::loadSettings()
     m_autoClear   = s.value("autoClear", false).toBool();
     m_alwaysOnTop = s.value("alwaysOnTop", true).toBool();
 
+    // New logins use the original derivation unless chosen otherwise
+    Kdf::Algorithm kdf = Kdf::LEGACY_MD5;
+    Kdf::parseName(s.value("kdf").toString(), kdf);
+    m_kdf = Kdf::Params(kdf, s.value("kdfCost", 0).toUInt());
+    if (m_kdf.isLegacy() || !m_kdf.isValid())
+    {
+        m_kdf = Kdf::Params();
+    }
+
+    // Not in the settings dialog, lower it on slow remote displays
+    m_passwdEdit->setFrameRate(s.value("fadeFrameRate", m_passwdEdit->frameRate()).toInt());
+
     const int defaultLength = s.value("length", m_defaultLength).toInt();
 
     m_settingsDlg->setSettings(m_masterDelay,
-        m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop);
-    m_timeLine->setDuration(m_loginDelay * 1000);
+        m_loginDelay, m_autoCopy, m_autoClear, m_alwaysOnTop, m_kdf.algorithm);
     m_masterTimer->setInterval(m_masterDelay * 60 * 1000);
 
     // Read login data
-    m_urlCombo->clear();
-    m_loginHash.clear();
+    m_logins.clear();
 
-    // Loop through saved logins
+    // The store can't be loaded while the worker writes to it
+    if (m_storeWorker && !m_storeWorker->flush())
+    {
+        showStoreError();
+    }
+
+    // Logins saved to the settings by older versions are moved to the store
+    LoginIO::LoginList oldLogins;
     const int size = s.beginReadArray("logins");
     for (int i = 0; i < size; i++)
     {
         s.setArrayIndex(i);
-
-        // Read the url
-        const QString url = s.value("url").toString();
-
-        // Add url to the combo box
-        m_urlCombo->addItem(url);
-
-        // Add url to the login data hash
-        m_loginHash[url] = LoginData(url,
+        oldLogins << LoginData(s.value("url").toString(),
             s.value("user").toString(),
             s.value("length", defaultLength).toInt());
     }
     s.endArray();
 
-    // Sort the combo box
-    m_urlCombo->model()->sort(0);
+    // Start from the image written after the last change if the store
+    // hasn't changed since
+    QVector<QString> sortedUrls;
+    m_cachedState = m_loginStore->state();
+    if (size == 0 &&
+        m_startupCache->read(m_cachedState, m_logins, sortedUrls) &&
+        m_loginStore->open(m_cachedState))
+    {
+        m_urlModel->setSortedUrls(sortedUrls);
+    }
+    else
+    {
+        m_logins.clear();
+        m_cachedState.clear();
+
+        LoginIO::LoginList logins;
+        if (!m_loginStore->load(logins))
+        {
+            showStoreError();
+        }
+
+        if (size > 0 && m_loginStore->save(oldLogins))
+        {
+            s.remove("logins");
+        }
+
+        logins += oldLogins;
+
+        // Add the saved logins to the login table
+        m_logins.reserve(logins.count());
+        for (int i = 0; i < logins.count(); i++)
+        {
+            m_logins.insert(logins.at(i));
+        }
+
+        // Fill the combo box, sorted in one go
+        m_urlModel->setUrls(m_logins.urls());
+
+        // Let the next start skip loading the store
+        m_cacheTimer->start();
+    }
 
     // Set the current index to zero
     // and update related fields.
     m_urlCombo->setCurrentIndex(0);
-    updateUser(m_urlCombo->currentText());
+    scheduleInputUpdate(URL_INPUT);
+    updateInputState();
 }
 
 void MainWindow::saveSettings()
@@ -508,26 +753,36 @@ void MainWindow::saveSettings()
     s.setValue("autoCopy",    m_autoCopy);
     s.setValue("autoClear",   m_autoClear);
     s.setValue("alwaysOnTop", m_alwaysOnTop);
+    s.setValue("kdf",         Kdf::name(m_kdf.algorithm));
+    s.setValue("kdfCost",     m_kdf.cost);
+}
 
-    // Write login data that user wants to be saved
-    s.beginWriteArray("logins");
-    QList<LoginData> values = m_loginHash.values();
-    for (int i = 0; i < values.count(); i++)
-    {
-        s.setArrayIndex(i);
-        s.setValue("url",    values.at(i).url());
-        s.setValue("user",   values.at(i).userName());
-        s.setValue("length", values.at(i).passwordLength());
-    }
-    s.endArray();
+void MainWindow::showStoreError()
+{
+    QMessageBox::warning(this, Config::NAME,
+        tr("Failed to save the logins to '") + LoginStore::defaultDirectory() + "'");
 }
 
 void MainWindow::doGenerate()
 {
-    QString passwd = Engine::generate(m_masterEdit->text(),
-        m_urlCombo->currentText(),
+    TRACE_SPAN("MainWindow::doGenerate");
+
+    // Apply a pending input change now, since it would clear the
+    // generated password when applied later
+    if (m_inputTimer->isActive())
+    {
+        updateInputState();
+    }
+
+    if (!m_master)
+    {
+        m_master = new Engine::Master(m_masterEdit->text());
+    }
+
+    QString passwd = m_master->generate(LoginData(m_urlCombo->currentText(),
         m_userEdit->text(),
-        m_lengthSpinBox->value());
+        m_lengthSpinBox->value(),
+        currentKdf()));
 
     // Enable the text field and  show the generated passwd
     m_passwdEdit->setEnabled(true);
@@ -540,18 +795,8 @@ void MainWindow::doGenerate()
         m_passwdEdit->copy();
     }
 
-    // Start timer to slowly fade out the text
-    m_timeLine->stop();
-    m_timeLine->start();
-}
-
-void MainWindow::decreasePasswordAlpha(int frame)
-{
-    QColor color = QColor();
-    color.setAlpha(255 - frame);
-    QPalette palette = QPalette(m_passwdEdit->palette());
-    palette.setColor(QPalette::Text, color);
-    m_passwdEdit->setPalette(palette);
+    // Slowly fade out the text
+    m_passwdEdit->startFade(m_loginDelay * 1000);
 }
 
 void MainWindow::invalidate()
@@ -576,22 +821,9 @@ void MainWindow::invalidateAll()
     m_urlCombo->setEditText("");
 }
 
-void MainWindow::enableGenButton()
-{
-    m_genButton->setEnabled(m_masterEdit->text().length() > 0 &&
-        m_urlCombo->currentText().length() > 0 &&
-        m_userEdit->text().length() > 0);
-}
-
-void MainWindow::enableSaveButton()
+void MainWindow::setMasterPasswordLabelColor(int length)
 {
-    m_saveButton->setEnabled(m_urlCombo->currentText().length() > 0 &&
-        m_userEdit->text().length() > 0);
-}
-
-void MainWindow::setMasterPasswordLabelColor()
-{
-    float scale = static_cast<float>(m_masterEdit->text().length()) / 8;
+    float scale = static_cast<float>(length) / GOOD_MASTER_LENGTH;
     scale = scale > 1.0 ? 1.0 : scale;
 
     QColor color;
@@ -604,29 +836,43 @@ void MainWindow::setMasterPasswordLabelColor()
     m_masterLabel->setPalette(palette);
 }
 
+Kdf::Params MainWindow::currentKdf() const
+{
+    const int row = m_logins.find(m_urlCombo->currentText());
+    if (row >= 0 && m_logins.at(row).userName() == m_userEdit->text())
+    {
+        return m_logins.at(row).kdf();
+    }
+
+    return m_kdf;
+}
+
 void MainWindow::saveOrRemoveLogin()
 {
+    // Act on the current inputs
+    if (m_inputTimer->isActive())
+    {
+        updateInputState();
+    }
+
     const QString user = m_userEdit->text();
     const QString url  = m_urlCombo->currentText();
 
-    if (m_saveButton->text() == m_saveText)
+    if (!m_inputState.removeMode)
     {
         // Save url and user
-        const int index = m_urlCombo->findText(url);
-        if (index == -1)
-        {
-            m_urlCombo->addItem(url);
-            m_urlCombo->model()->sort(0);
-        }
+        m_urlModel->add(url);
 
-        // Update the corresponding login data in the hash
-        m_loginHash[url] = LoginData(url, user, m_lengthSpinBox->value());
+        // Update the corresponding login data in the table
+        const LoginData login(url, user, m_lengthSpinBox->value(), currentKdf());
+        m_logins.insert(login);
 
-        // Save settings
-        saveSettings();
+        // Save the login
+        m_storeWorker->save(login);
+        m_cacheTimer->start();
 
         // Change the button text to "remove"
-        m_saveButton->setText(m_removeText);
+        updateInputState();
 
 #ifndef __ANDROID__
         // Show a message box
@@ -638,20 +884,17 @@ void MainWindow::saveOrRemoveLogin()
     else
     {
         // Remove url and user
-        const int index = m_urlCombo->findText(url);
-        if (index != -1)
-        {
-            m_urlCombo->removeItem(index);
-        }
+        m_urlModel->remove(url);
 
-        // Remove the corresponding login data from the hash
-        m_loginHash.remove(url);
+        // Remove the corresponding login data from the table
+        m_logins.remove(url);
 
-        // Save settings
-        saveSettings();
+        // Remove the saved login
+        m_storeWorker->remove(url);
+        m_cacheTimer->start();
 
         // Update the button text
-        toggleSaveButtonText();
+        updateInputState();
 
 #ifndef __ANDROID__
         // Show a message box
@@ -662,51 +905,113 @@ void MainWindow::saveOrRemoveLogin()
     }
 }
 
-void MainWindow::updateUser(const QString & url)
+void MainWindow::scheduleInputUpdate(int inputs)
 {
-    if (m_loginHash.contains(url))
+    m_changedInputs |= inputs;
+    if (!m_inputTimer->isActive())
     {
-        // Update the user name field
-        m_userEdit->setText(m_loginHash.value(url).userName());
+        m_inputTimer->start();
+    }
+}
 
-        // Update the password length spinbox
-        m_lengthSpinBox->setValue(m_loginHash.value(url).passwordLength());
+void MainWindow::masterChanged()
+{
+    delete m_master;
+    m_master = 0;
 
-        // Change the text in save-button to "remove"
-        m_saveButton->setText(m_removeText);
-    }
+    m_inputCounters.slotCalls++;
+    scheduleInputUpdate(MASTER_INPUT);
 }
 
-void MainWindow::toggleSaveButtonText()
+void MainWindow::urlChanged()
 {
-    // Set remove-text if url is saved.
-    // Set save-text if url is not
-    // saved or user/length is changed.
+    m_inputCounters.slotCalls++;
+    scheduleInputUpdate(URL_INPUT);
+}
+
+void MainWindow::userChanged()
+{
+    m_inputCounters.slotCalls++;
+    scheduleInputUpdate(USER_INPUT);
+}
+
+void MainWindow::lengthChanged()
+{
+    m_inputCounters.slotCalls++;
+    scheduleInputUpdate(LENGTH_INPUT);
+}
+
+void MainWindow::updateInputState()
+{
+    m_inputCounters.slotCalls++;
+    m_inputTimer->stop();
+
+    const int changed = m_changedInputs;
+    m_changedInputs = 0;
 
     const QString url = m_urlCombo->currentText();
-    if (m_loginHash.contains(url))
+
+    m_inputCounters.lookups++;
+    const int  row   = m_logins.find(url);
+    const bool saved = row >= 0;
+
+    // Update the user name and length of a saved url. They are
+    // accounted for below, so their change signals are blocked.
+    if ((changed & URL_INPUT) && saved)
     {
-        const QString currentUser   = m_userEdit->text();
-        const int     currentLength = m_lengthSpinBox->value();
-        const QString savedUser     = m_loginHash.value(url).userName();
-        const int     savedLength   = m_loginHash.value(url).passwordLength();
+        const LoginTable::Login login = m_logins.at(row);
 
-        if (currentUser != savedUser || currentLength != savedLength)
-        {
-            m_saveButton->setText(m_saveText);
-            m_saveButton->setToolTip(m_saveToolTip);
-        }
-        else
-        {
-            m_saveButton->setText(m_removeText);
-            m_saveButton->setToolTip(m_removeToolTip);
-        }
+        m_userEdit->blockSignals(true);
+        m_userEdit->setText(login.userName());
+        m_userEdit->blockSignals(false);
+
+        m_lengthSpinBox->blockSignals(true);
+        m_lengthSpinBox->setValue(login.passwordLength());
+        m_lengthSpinBox->blockSignals(false);
     }
-    else
+
+    // Invalidate generated password if one of the inputs got changed
+    if (changed & (MASTER_INPUT | URL_INPUT | USER_INPUT))
     {
-        m_saveButton->setText(m_saveText);
-        m_saveButton->setToolTip(m_saveToolTip);
+        invalidate();
     }
+
+    const QString user         = m_userEdit->text();
+    const int     masterLength = m_masterEdit->text().length();
+
+    InputState state;
+    state.saveEnabled  = !url.isEmpty() && !user.isEmpty();
+    state.genEnabled   = state.saveEnabled && masterLength > 0;
+    state.masterLength = qMin(masterLength, GOOD_MASTER_LENGTH);
+
+    // Offer removal if the url is saved with the current user and length
+    state.removeMode = saved &&
+        m_logins.at(row).userName() == user &&
+        m_logins.at(row).passwordLength() == m_lengthSpinBox->value();
+
+    // Apply only what changed
+    if (state.genEnabled != m_inputState.genEnabled)
+    {
+        m_genButton->setEnabled(state.genEnabled);
+    }
+
+    if (state.saveEnabled != m_inputState.saveEnabled)
+    {
+        m_saveButton->setEnabled(state.saveEnabled);
+    }
+
+    if (state.removeMode != m_inputState.removeMode)
+    {
+        m_saveButton->setText(state.removeMode ? m_removeText : m_saveText);
+        m_saveButton->setToolTip(state.removeMode ? m_removeToolTip : m_saveToolTip);
+    }
+
+    if (state.masterLength != m_inputState.masterLength)
+    {
+        setMasterPasswordLabelColor(state.masterLength);
+    }
+
+    m_inputState = state;
 }
 
 void MainWindow::closeEvent(QCloseEvent * event)
@@ -717,10 +1022,32 @@ void MainWindow::closeEvent(QCloseEvent * event)
     s.setValue("width", width());
     s.setValue("height", height());
 
+    // Stop a running import, its changes are not applied
+    if (m_importWorker)
+    {
+        m_importWorker->cancel();
+        m_importWorker->wait();
+    }
+
+    // Keep the key derivation chosen just before closing
+    if (m_kdfCalibration)
+    {
+        m_kdfCalibration->wait();
+        finishKdfCalibration();
+    }
+
+    // Make sure that the last changes are on disk
+    writeStartupCache();
+
     QApplication::clipboard()->clear();
     event->accept();
 }
 
+void MainWindow::paintEvent(QPaintEvent * event)
+{
+    m_background.paint(*this, event->rect());
+}
+
 void MainWindow::clearFields()
 {
     m_userEdit->clear();
@@ -728,8 +1055,42 @@ void MainWindow::clearFields()
     m_lengthSpinBox->setValue(m_defaultLength);
 }
 
+void MainWindow::writeStartupCache()
+{
+    m_cacheTimer->stop();
+
+    // The cache must match the store, so the queued changes go first
+    if (!m_storeWorker->flush())
+    {
+        showStoreError();
+        return;
+    }
+
+    const QByteArray state = m_loginStore->state();
+    if (state != m_cachedState && m_startupCache->write(state, m_logins, *m_urlModel))
+    {
+        m_cachedState = state;
+    }
+}
+
 MainWindow::~MainWindow()
 {
-    delete m_timeLine;
+    if (m_importWorker)
+    {
+        m_importWorker->cancel();
+        m_importWorker->wait();
+        delete m_importWorker;
+    }
+
+    if (m_kdfCalibration)
+    {
+        m_kdfCalibration->wait();
+        delete m_kdfCalibration;
+    }
+
     delete m_masterTimer;
+    delete m_master;
+    delete m_storeWorker;
+    delete m_startupCache;
+    delete m_loginStore;
 }
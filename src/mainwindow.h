@@ -17,25 +17,40 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include <QHash>
+#include <QByteArray>
 #include <QMainWindow>
 
-#include "logindata.h"
+#include "backgroundrenderer.h"
+#include "logintable.h"
 
+class FadingLineEdit;
+class ImportWorker;
+class LoginStore;
 class SettingsDlg;
+class StartupCache;
+class StoreWorker;
+class UrlListModel;
 class QComboBox;
 class QLabel;
 class QLineEdit;
+class QProgressDialog;
 class QPushButton;
 class QSpinBox;
-class QTimeLine;
+class QThread;
 class QTimer;
 
+namespace Engine
+{
+    class Master;
+}
+
 //! The main window.
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
+    friend class BenchmarkAccess;
+
 public:
 
     //! Constructor
@@ -49,12 +64,15 @@ protected:
     //! \reimp
     virtual void closeEvent(QCloseEvent * event);
 
+    //! \reimp
+    virtual void paintEvent(QPaintEvent * event);
+
 private:
 
     //! Center the window or load previous location.
     void centerOrRestoreLocation();
 
-    //! Init the background image.
+    //! Init the background painting.
     void initBackground();
 
     //! Init the widgets.
@@ -66,12 +84,36 @@ private:
     //! Connect the signals emitted by widgets.
     void connectSignalsFromWidgets();
 
-    //! Load settings by using QSettings.
+    //! Load settings by using QSettings and the saved logins.
     void loadSettings();
 
-    //! Save settings by using QSettings.
+    //! Save settings by using QSettings. The logins are saved
+    //! to the login store as they change.
     void saveSettings();
 
+    //! Tell the user that changing the saved logins failed.
+    void showStoreError();
+
+    //! Inputs whose changes affect the state of the other widgets.
+    enum Input
+    {
+        MASTER_INPUT = 1,
+        URL_INPUT    = 2,
+        USER_INPUT   = 4,
+        LENGTH_INPUT = 8
+    };
+
+    //! Mark the given inputs changed and update the input state
+    //! once the event loop gets idle.
+    void scheduleInputUpdate(int inputs);
+
+    //! Set green or red color for the master password label.
+    void setMasterPasswordLabelColor(int length);
+
+    //! Key derivation of the current login: the saved one if the url
+    //! is saved with the current user, otherwise the one of new logins.
+    Kdf::Params currentKdf() const;
+
     //! Show the master password for this long in mins.
     int m_defaultMasterDelay;
 
@@ -111,6 +153,9 @@ private:
     //! True, if window is always on top.
     bool m_alwaysOnTop;
 
+    //! Key derivation of new logins.
+    Kdf::Params m_kdf;
+
     //! Master password edit field
     QLineEdit * m_masterEdit;
 
@@ -121,11 +166,14 @@ private:
     QLineEdit * m_userEdit;
 
     //! Password edit field
-    QLineEdit * m_passwdEdit;
+    FadingLineEdit * m_passwdEdit;
 
     //! Url combo box
     QComboBox * m_urlCombo;
 
+    //! Sorted saved urls shown by the url combo box
+    UrlListModel * m_urlModel;
+
     //! Generate button
     QPushButton * m_genButton;
 
@@ -139,57 +187,144 @@ private:
     //! Timer used when showing the master password.
     QTimer * m_masterTimer;
 
-    //! Time line used when showing the generated password.
-    QTimeLine * m_timeLine;
+    //! The master password prepared for generating, created on the first
+    //! generate and dropped when the master changes or times out.
+    Engine::Master * m_master;
 
     //! Settings dialog
     SettingsDlg * m_settingsDlg;
 
-    typedef QHash<QString, LoginData> LoginHash;
-    LoginHash m_loginHash;
+    //! Persistent storage of the saved logins.
+    LoginStore * m_loginStore;
+
+    //! Image of the saved logins for a fast start.
+    StartupCache * m_startupCache;
+
+    //! State of the login store that the startup cache matches.
+    QByteArray m_cachedState;
+
+    //! Single shot timer writing the startup cache after the saved
+    //! logins have changed.
+    QTimer * m_cacheTimer;
+
+    //! Writes the changes of the saved logins in the background.
+    StoreWorker * m_storeWorker;
+
+    //! Running import, if any.
+    ImportWorker * m_importWorker;
+
+    //! Progress of the running import.
+    QProgressDialog * m_importProgress;
+
+    //! Running calibration of the key derivation chosen in the settings, if any.
+    QThread * m_kdfCalibration;
+
+    //! Zero timer used to update the input state once per event loop turn.
+    QTimer * m_inputTimer;
+
+    //! Inputs changed since the last update of the input state.
+    int m_changedInputs;
+
+    //! State of the widgets derived from the inputs.
+    struct InputState
+    {
+        InputState()
+        : genEnabled(false)
+        , saveEnabled(false)
+        , removeMode(false)
+        , masterLength(0)
+        {}
+
+        bool genEnabled;
+        bool saveEnabled;
+
+        //! True if the login is saved as is.
+        bool removeMode;
+
+        //! Length of the master password, capped to the length shown in green.
+        int masterLength;
+    };
+
+    //! Input state last applied to the widgets.
+    InputState m_inputState;
+
+    //! Work done for the input changes, read by the benchmarks.
+    struct InputCounters
+    {
+        InputCounters()
+        : slotCalls(0)
+        , lookups(0)
+        {}
+
+        int slotCalls;
+        int lookups;
+    };
+
+    InputCounters m_inputCounters;
+
+    //! The saved logins.
+    LoginTable m_logins;
+
+    //! Paints the background image.
+    BackgroundRenderer m_background;
 
 private slots:
 
     //! Generate the password.
     void doGenerate();
 
-    //! Decrease the alpha of the color of the password by one.
-    void decreasePasswordAlpha(int frame);
-
     //! Clear the generated password and disable the text field.
     void invalidate();
 
     //! Like invalidate + clear all login details.
     void invalidateAll();
 
-    //! Enable the generate-button.
-    void enableGenButton();
-
-    //! Enable the save-button.
-    void enableSaveButton();
-
-    //! Set green or red color for the master password label.
-    void setMasterPasswordLabelColor();
-
     //! Save or remove the active url/user-pair depending
     //! on the button state.
     void saveOrRemoveLogin();
 
-    //! Update the user field if the url/user-pair is known.
-    void updateUser(const QString & url);
+    //! The master password was edited.
+    void masterChanged();
+
+    //! The url was edited or selected.
+    void urlChanged();
+
+    //! The user name was edited.
+    void userChanged();
+
+    //! The password length was changed.
+    void lengthChanged();
 
-    //! Set the text for save/remove-button.
-    void toggleSaveButtonText();
+    //! Derive the state of the other widgets from the inputs with a
+    //! single login lookup and apply the parts that changed. Fills in
+    //! the user name and length of a saved url when the url changed.
+    void updateInputState();
 
-    //! Import logins
+    //! Start importing logins in the background.
     void importLogins();
 
+    //! Show the progress of the running import.
+    void updateImportProgress();
+
+    //! Cancel the running import.
+    void cancelImport();
+
+    //! Apply the changes of a finished import.
+    void finishImport();
+
     //! Export logins
     void exportLogins();
 
     //! Show the settings dialog.
     void showSettingsDlg();
 
+    //! Use the cost of a finished calibration for new logins.
+    void finishKdfCalibration();
+
+    //! Write the queued changes of the saved logins and the startup
+    //! cache, if the login store has changed since it was last written.
+    void writeStartupCache();
+
     //! Show the instructions dialog.
     void showInstructionsDlg();
 
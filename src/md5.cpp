@@ -0,0 +1,466 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "md5.h"
+
+#include <cstring>
+
+// The multi-buffer kernels use GCC vector extensions and per-function
+// target attributes, so that a generic x86 build can still run the
+// AVX2 and AVX-512 kernels on CPUs that have them.
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MD5_X86
+#define MD5_INLINE inline __attribute__((always_inline))
+#else
+#define MD5_INLINE inline
+#endif
+
+#define MD5_ROUND_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_ROUND_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_ROUND_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_ROUND_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+#define MD5_ROTATE(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define MD5_STEP(f, a, b, c, d, x, k, s)  \
+    (a) += f((b), (c), (d)) + (x) + (k); \
+    (a) = MD5_ROTATE((a), (s)) + (b);
+
+namespace
+{
+    const quint32 INITIAL_STATE[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+    const int BLOCK_SIZE = 64;
+
+    //! The MD5 compression function. T is either a 32-bit word or a vector
+    //! of them, in which case every lane is an independent message.
+    template <typename T>
+    MD5_INLINE void compress(T * state, const T * x)
+    {
+        T a = state[0];
+        T b = state[1];
+        T c = state[2];
+        T d = state[3];
+
+        MD5_STEP(MD5_ROUND_F, a, b, c, d, x[ 0], 0xd76aa478,  7)
+        MD5_STEP(MD5_ROUND_F, d, a, b, c, x[ 1], 0xe8c7b756, 12)
+        MD5_STEP(MD5_ROUND_F, c, d, a, b, x[ 2], 0x242070db, 17)
+        MD5_STEP(MD5_ROUND_F, b, c, d, a, x[ 3], 0xc1bdceee, 22)
+        MD5_STEP(MD5_ROUND_F, a, b, c, d, x[ 4], 0xf57c0faf,  7)
+        MD5_STEP(MD5_ROUND_F, d, a, b, c, x[ 5], 0x4787c62a, 12)
+        MD5_STEP(MD5_ROUND_F, c, d, a, b, x[ 6], 0xa8304613, 17)
+        MD5_STEP(MD5_ROUND_F, b, c, d, a, x[ 7], 0xfd469501, 22)
+        MD5_STEP(MD5_ROUND_F, a, b, c, d, x[ 8], 0x698098d8,  7)
+        MD5_STEP(MD5_ROUND_F, d, a, b, c, x[ 9], 0x8b44f7af, 12)
+        MD5_STEP(MD5_ROUND_F, c, d, a, b, x[10], 0xffff5bb1, 17)
+        MD5_STEP(MD5_ROUND_F, b, c, d, a, x[11], 0x895cd7be, 22)
+        MD5_STEP(MD5_ROUND_F, a, b, c, d, x[12], 0x6b901122,  7)
+        MD5_STEP(MD5_ROUND_F, d, a, b, c, x[13], 0xfd987193, 12)
+        MD5_STEP(MD5_ROUND_F, c, d, a, b, x[14], 0xa679438e, 17)
+        MD5_STEP(MD5_ROUND_F, b, c, d, a, x[15], 0x49b40821, 22)
+
+        MD5_STEP(MD5_ROUND_G, a, b, c, d, x[ 1], 0xf61e2562,  5)
+        MD5_STEP(MD5_ROUND_G, d, a, b, c, x[ 6], 0xc040b340,  9)
+        MD5_STEP(MD5_ROUND_G, c, d, a, b, x[11], 0x265e5a51, 14)
+        MD5_STEP(MD5_ROUND_G, b, c, d, a, x[ 0], 0xe9b6c7aa, 20)
+        MD5_STEP(MD5_ROUND_G, a, b, c, d, x[ 5], 0xd62f105d,  5)
+        MD5_STEP(MD5_ROUND_G, d, a, b, c, x[10], 0x02441453,  9)
+        MD5_STEP(MD5_ROUND_G, c, d, a, b, x[15], 0xd8a1e681, 14)
+        MD5_STEP(MD5_ROUND_G, b, c, d, a, x[ 4], 0xe7d3fbc8, 20)
+        MD5_STEP(MD5_ROUND_G, a, b, c, d, x[ 9], 0x21e1cde6,  5)
+        MD5_STEP(MD5_ROUND_G, d, a, b, c, x[14], 0xc33707d6,  9)
+        MD5_STEP(MD5_ROUND_G, c, d, a, b, x[ 3], 0xf4d50d87, 14)
+        MD5_STEP(MD5_ROUND_G, b, c, d, a, x[ 8], 0x455a14ed, 20)
+        MD5_STEP(MD5_ROUND_G, a, b, c, d, x[13], 0xa9e3e905,  5)
+        MD5_STEP(MD5_ROUND_G, d, a, b, c, x[ 2], 0xfcefa3f8,  9)
+        MD5_STEP(MD5_ROUND_G, c, d, a, b, x[ 7], 0x676f02d9, 14)
+        MD5_STEP(MD5_ROUND_G, b, c, d, a, x[12], 0x8d2a4c8a, 20)
+
+        MD5_STEP(MD5_ROUND_H, a, b, c, d, x[ 5], 0xfffa3942,  4)
+        MD5_STEP(MD5_ROUND_H, d, a, b, c, x[ 8], 0x8771f681, 11)
+        MD5_STEP(MD5_ROUND_H, c, d, a, b, x[11], 0x6d9d6122, 16)
+        MD5_STEP(MD5_ROUND_H, b, c, d, a, x[14], 0xfde5380c, 23)
+        MD5_STEP(MD5_ROUND_H, a, b, c, d, x[ 1], 0xa4beea44,  4)
+        MD5_STEP(MD5_ROUND_H, d, a, b, c, x[ 4], 0x4bdecfa9, 11)
+        MD5_STEP(MD5_ROUND_H, c, d, a, b, x[ 7], 0xf6bb4b60, 16)
+        MD5_STEP(MD5_ROUND_H, b, c, d, a, x[10], 0xbebfbc70, 23)
+        MD5_STEP(MD5_ROUND_H, a, b, c, d, x[13], 0x289b7ec6,  4)
+        MD5_STEP(MD5_ROUND_H, d, a, b, c, x[ 0], 0xeaa127fa, 11)
+        MD5_STEP(MD5_ROUND_H, c, d, a, b, x[ 3], 0xd4ef3085, 16)
+        MD5_STEP(MD5_ROUND_H, b, c, d, a, x[ 6], 0x04881d05, 23)
+        MD5_STEP(MD5_ROUND_H, a, b, c, d, x[ 9], 0xd9d4d039,  4)
+        MD5_STEP(MD5_ROUND_H, d, a, b, c, x[12], 0xe6db99e5, 11)
+        MD5_STEP(MD5_ROUND_H, c, d, a, b, x[15], 0x1fa27cf8, 16)
+        MD5_STEP(MD5_ROUND_H, b, c, d, a, x[ 2], 0xc4ac5665, 23)
+
+        MD5_STEP(MD5_ROUND_I, a, b, c, d, x[ 0], 0xf4292244,  6)
+        MD5_STEP(MD5_ROUND_I, d, a, b, c, x[ 7], 0x432aff97, 10)
+        MD5_STEP(MD5_ROUND_I, c, d, a, b, x[14], 0xab9423a7, 15)
+        MD5_STEP(MD5_ROUND_I, b, c, d, a, x[ 5], 0xfc93a039, 21)
+        MD5_STEP(MD5_ROUND_I, a, b, c, d, x[12], 0x655b59c3,  6)
+        MD5_STEP(MD5_ROUND_I, d, a, b, c, x[ 3], 0x8f0ccc92, 10)
+        MD5_STEP(MD5_ROUND_I, c, d, a, b, x[10], 0xffeff47d, 15)
+        MD5_STEP(MD5_ROUND_I, b, c, d, a, x[ 1], 0x85845dd1, 21)
+        MD5_STEP(MD5_ROUND_I, a, b, c, d, x[ 8], 0x6fa87e4f,  6)
+        MD5_STEP(MD5_ROUND_I, d, a, b, c, x[15], 0xfe2ce6e0, 10)
+        MD5_STEP(MD5_ROUND_I, c, d, a, b, x[ 6], 0xa3014314, 15)
+        MD5_STEP(MD5_ROUND_I, b, c, d, a, x[13], 0x4e0811a1, 21)
+        MD5_STEP(MD5_ROUND_I, a, b, c, d, x[ 4], 0xf7537e82,  6)
+        MD5_STEP(MD5_ROUND_I, d, a, b, c, x[11], 0xbd3af235, 10)
+        MD5_STEP(MD5_ROUND_I, c, d, a, b, x[ 2], 0x2ad7d2bb, 15)
+        MD5_STEP(MD5_ROUND_I, b, c, d, a, x[ 9], 0xeb86d391, 21)
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+    //! Read a little-endian word.
+    MD5_INLINE quint32 readWord(const quint8 * p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<quint32>(p[3]) << 24);
+    }
+
+    //! Write a little-endian word.
+    MD5_INLINE void writeWord(quint32 word, quint8 * p)
+    {
+        p[0] = word;
+        p[1] = word >> 8;
+        p[2] = word >> 16;
+        p[3] = word >> 24;
+    }
+
+    //! Return the number of blocks of the padded message.
+    MD5_INLINE int blockCount(int size)
+    {
+        return (size + 8) / BLOCK_SIZE + 1;
+    }
+
+    //! Decode the given block of the padded message to words. The message
+    //! continues a prefix of prefixSize bytes that is already absorbed.
+    MD5_INLINE void paddedBlock(const char * data, int size, quint64 prefixSize, int block,
+        quint32 * words)
+    {
+        const int begin = block * BLOCK_SIZE;
+        const int bytes = qMax(0, qMin(size - begin, BLOCK_SIZE));
+
+        quint8 buffer[BLOCK_SIZE];
+        std::memcpy(buffer, data + begin, bytes);
+        std::memset(buffer + bytes, 0, BLOCK_SIZE - bytes);
+
+        if (size >= begin && size < begin + BLOCK_SIZE)
+        {
+            buffer[size - begin] = 0x80;
+        }
+
+        if (block == blockCount(size) - 1)
+        {
+            const quint64 bits = (prefixSize + size) * 8;
+            writeWord(static_cast<quint32>(bits), buffer + 56);
+            writeWord(static_cast<quint32>(bits >> 32), buffer + 60);
+        }
+
+        for (int i = 0; i < 16; i++)
+        {
+            words[i] = readWord(buffer + i * 4);
+        }
+    }
+
+    //! Hash a single message continuing the prefix.
+    void hashFrom(const Md5::Midstate & prefix, const char * data, int size,
+        Md5::Digest & rDigest)
+    {
+        quint32 state[4] = {prefix.state[0], prefix.state[1], prefix.state[2], prefix.state[3]};
+
+        const int blocks = blockCount(size);
+        for (int block = 0; block < blocks; block++)
+        {
+            quint32 words[16];
+            paddedBlock(data, size, prefix.size, block, words);
+            compress(state, words);
+        }
+
+        for (int i = 0; i < 4; i++)
+        {
+            writeWord(state[i], rDigest + i * 4);
+        }
+    }
+
+    //! Hash up to N messages continuing the prefix in the lanes of
+    //! the vector type V.
+    template <typename V, int N>
+    MD5_INLINE void hashLanes(const Md5::Midstate & prefix, const char * const * data,
+        const int * sizes, int count, Md5::Digest * rDigests)
+    {
+        int blocks[N];
+        int maxBlocks = 0;
+        for (int lane = 0; lane < N; lane++)
+        {
+            blocks[lane] = lane < count ? blockCount(sizes[lane]) : 0;
+            maxBlocks    = qMax(maxBlocks, blocks[lane]);
+        }
+
+        V state[4];
+        for (int i = 0; i < 4; i++)
+        {
+            state[i] = V() + prefix.state[i];
+        }
+
+        for (int block = 0; block < maxBlocks; block++)
+        {
+            // Transpose the lanes' blocks so that word i of every
+            // message lands in vector i. Lanes whose message has already
+            // ended are masked out and keep their state.
+            quint32 words[16][N];
+            quint32 mask[N];
+            for (int lane = 0; lane < N; lane++)
+            {
+                quint32 laneWords[16] = {0};
+                if (block < blocks[lane])
+                {
+                    paddedBlock(data[lane], sizes[lane], prefix.size, block, laneWords);
+                }
+
+                for (int i = 0; i < 16; i++)
+                {
+                    words[i][lane] = laneWords[i];
+                }
+
+                mask[lane] = block < blocks[lane] ? ~0u : 0u;
+            }
+
+            V x[16];
+            std::memcpy(x, words, sizeof(x));
+
+            V active;
+            std::memcpy(&active, mask, sizeof(active));
+
+            V next[4] = {state[0], state[1], state[2], state[3]};
+            compress(next, x);
+
+            for (int i = 0; i < 4; i++)
+            {
+                state[i] = (next[i] & active) | (state[i] & ~active);
+            }
+        }
+
+        quint32 words[4][N];
+        std::memcpy(words, state, sizeof(words));
+        for (int lane = 0; lane < count; lane++)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                writeWord(words[i][lane], rDigests[lane] + i * 4);
+            }
+        }
+    }
+
+#ifdef MD5_X86
+    typedef quint32 Vec4  __attribute__((vector_size(16)));
+    typedef quint32 Vec8  __attribute__((vector_size(32)));
+    typedef quint32 Vec16 __attribute__((vector_size(64)));
+
+    __attribute__((target("sse2")))
+    void hashLanes4(const Md5::Midstate & prefix, const char * const * data,
+        const int * sizes, int count, Md5::Digest * rDigests)
+    {
+        hashLanes<Vec4, 4>(prefix, data, sizes, count, rDigests);
+    }
+
+    __attribute__((target("avx2")))
+    void hashLanes8(const Md5::Midstate & prefix, const char * const * data,
+        const int * sizes, int count, Md5::Digest * rDigests)
+    {
+        hashLanes<Vec8, 8>(prefix, data, sizes, count, rDigests);
+    }
+
+    __attribute__((target("avx512f")))
+    void hashLanes16(const Md5::Midstate & prefix, const char * const * data,
+        const int * sizes, int count, Md5::Digest * rDigests)
+    {
+        hashLanes<Vec16, 16>(prefix, data, sizes, count, rDigests);
+    }
+#endif
+
+    int detectMaxLanes()
+    {
+#ifdef MD5_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return 16;
+        }
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return 8;
+        }
+
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return 4;
+        }
+#endif
+        return 1;
+    }
+}
+
+Md5::Midstate::Midstate()
+: size(0)
+{
+    std::memcpy(state, INITIAL_STATE, sizeof(state));
+}
+
+Md5::Midstate Md5::midstate(const char * data, int size)
+{
+    Midstate prefix;
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE)
+    {
+        quint32 words[16];
+        for (int i = 0; i < 16; i++)
+        {
+            words[i] = readWord(reinterpret_cast<const quint8 *>(data) + i * 4);
+        }
+
+        compress(prefix.state, words);
+        prefix.size += BLOCK_SIZE;
+        data        += BLOCK_SIZE;
+    }
+
+    return prefix;
+}
+
+Md5::Context::Context()
+: m_size(0)
+{
+    std::memcpy(m_state, INITIAL_STATE, sizeof(m_state));
+}
+
+Md5::Context::Context(const Midstate & prefix)
+: m_size(prefix.size)
+{
+    std::memcpy(m_state, prefix.state, sizeof(m_state));
+}
+
+void Md5::Context::update(const char * data, int size)
+{
+    int used = m_size % BLOCK_SIZE;
+    m_size += size;
+
+    while (size > 0)
+    {
+        const int bytes = qMin(size, BLOCK_SIZE - used);
+        std::memcpy(m_block + used, data, bytes);
+        used += bytes;
+        data += bytes;
+        size -= bytes;
+
+        if (used == BLOCK_SIZE)
+        {
+            quint32 words[16];
+            for (int i = 0; i < 16; i++)
+            {
+                words[i] = readWord(m_block + i * 4);
+            }
+
+            compress(m_state, words);
+            used = 0;
+        }
+    }
+}
+
+void Md5::Context::finish(Digest & rDigest)
+{
+    // The rest of the message is the tail of the padded message
+    // whose complete blocks have already been absorbed.
+    const int used   = m_size % BLOCK_SIZE;
+    const int blocks = blockCount(used);
+    for (int block = 0; block < blocks; block++)
+    {
+        quint32 words[16];
+        paddedBlock(reinterpret_cast<const char *>(m_block), used, m_size - used, block, words);
+        compress(m_state, words);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        writeWord(m_state[i], rDigest + i * 4);
+    }
+}
+
+void Md5::hash(const char * data, int size, Digest & rDigest)
+{
+    hashFrom(Midstate(), data, size, rDigest);
+}
+
+void Md5::hashMany(const char * const * data, const int * sizes, int count,
+    Digest * rDigests, int lanes)
+{
+    hashMany(Midstate(), data, sizes, count, rDigests, lanes);
+}
+
+void Md5::hashMany(const Midstate & prefix, const char * const * data, const int * sizes,
+    int count, Digest * rDigests, int lanes)
+{
+    if (lanes <= 0 || !isSupported(lanes))
+    {
+        lanes = maxLanes();
+    }
+
+    for (int i = 0; i < count; i += lanes)
+    {
+        const int n = qMin(lanes, count - i);
+        switch (lanes)
+        {
+#ifdef MD5_X86
+        case 4:
+            hashLanes4(prefix, data + i, sizes + i, n, rDigests + i);
+            break;
+        case 8:
+            hashLanes8(prefix, data + i, sizes + i, n, rDigests + i);
+            break;
+        case 16:
+            hashLanes16(prefix, data + i, sizes + i, n, rDigests + i);
+            break;
+#endif
+        default:
+            hashFrom(prefix, data[i], sizes[i], rDigests[i]);
+            break;
+        }
+    }
+}
+
+bool Md5::isSupported(int lanes)
+{
+    switch (lanes)
+    {
+    case 1:
+        return true;
+    case 4:
+    case 8:
+    case 16:
+        return lanes <= maxLanes();
+    default:
+        return false;
+    }
+}
+
+int Md5::maxLanes()
+{
+    static const int lanes = detectMaxLanes();
+    return lanes;
+}
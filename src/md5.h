@@ -0,0 +1,106 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef MD5_H
+#define MD5_H
+
+#include <QtGlobal>
+
+//! MD5 (RFC 1321) for the password engine. Besides the plain one-message
+//! hash there is a multi-buffer variant that hashes several independent
+//! messages at once in the lanes of SSE2, AVX2 or AVX-512 registers.
+//! The widest kernel supported by the CPU is selected at runtime.
+namespace Md5
+{
+    //! Size of the digest in bytes.
+    const int DIGEST_SIZE = 16;
+
+    //! Digest type.
+    typedef quint8 Digest[DIGEST_SIZE];
+
+    //! Hash a single message.
+    void hash(const char * data, int size, Digest & rDigest);
+
+    //! Hash state after the complete blocks of a message prefix.
+    //! Messages sharing the prefix continue from it instead of
+    //! hashing those blocks again.
+    struct Midstate
+    {
+        //! Constructor. The state of an empty prefix.
+        Midstate();
+
+        //! Intermediate hash value.
+        quint32 state[4];
+
+        //! Bytes absorbed, a multiple of the block size.
+        quint64 size;
+    };
+
+    //! Return the state after the complete blocks of data. The
+    //! remaining size - Midstate::size bytes are left for the caller
+    //! to put in front of each message continuing from it.
+    Midstate midstate(const char * data, int size);
+
+    //! Incremental hash of a single message that is fed in pieces.
+    //! Works entirely on its own storage, so it can live on the stack.
+    class Context
+    {
+    public:
+
+        //! Constructor.
+        Context();
+
+        //! Constructor. Continue from the given prefix.
+        explicit Context(const Midstate & prefix);
+
+        //! Append data to the message.
+        void update(const char * data, int size);
+
+        //! Finish the message and store its digest to rDigest.
+        void finish(Digest & rDigest);
+
+    private:
+
+        //! Intermediate hash value.
+        quint32 m_state[4];
+
+        //! Bytes of the current, incomplete block.
+        quint8 m_block[64];
+
+        //! Total size of the message so far.
+        quint64 m_size;
+    };
+
+    //! Hash count independent messages to rDigests. Messages are hashed in
+    //! groups of the given lane count, which must be 1, 4, 8 or 16.
+    //! Zero selects the widest kernel supported by the CPU.
+    //! An unsupported lane count falls back to the widest supported one.
+    void hashMany(const char * const * data, const int * sizes, int count,
+        Digest * rDigests, int lanes = 0);
+
+    //! Like above, but each message continues the prefix: the digest
+    //! of i is that of the prefix message followed by data[i].
+    void hashMany(const Midstate & prefix, const char * const * data, const int * sizes,
+        int count, Digest * rDigests, int lanes = 0);
+
+    //! Return true if the given lane count is supported by the CPU.
+    bool isSupported(int lanes);
+
+    //! Return the lane count of the widest supported kernel.
+    int maxLanes();
+}
+
+#endif // MD5_H
@@ -0,0 +1,66 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <QtGlobal>
+
+//! The framed protocol of the generation daemon. All integers are big-endian.
+//!
+//! Every message is a frame: quint32 payload size followed by the payload.
+//!
+//! Request payload:  quint8 type, quint32 id, type-specific body.
+//!   GENERATE body:  quint8 length, quint16 url size, url as UTF-8,
+//!                   quint16 user size, user as UTF-8.
+//!   UNLOCK body:    the master password as UTF-8.
+//!   LOCK body:      empty.
+//!
+//! Response payload: quint8 status, quint32 id of the request,
+//!                   the password as Latin-1 for a successful GENERATE.
+//!
+//! Clients may pipeline any number of requests. Responses to GENERATE
+//! requests can be delayed until the end of the daemon's event loop turn
+//! so that the requests of all clients are generated as one batch.
+namespace Protocol
+{
+    //! Request types.
+    enum Type
+    {
+        GENERATE = 1,
+        UNLOCK   = 2,
+        LOCK     = 3
+    };
+
+    //! Response statuses.
+    enum Status
+    {
+        OK          = 0,
+        LOCKED      = 1,
+        BAD_REQUEST = 2
+    };
+
+    //! Size of the frame header.
+    const int HEADER_SIZE = 4;
+
+    //! Size of the request and response payload header.
+    const int PAYLOAD_HEADER_SIZE = 5;
+
+    //! Largest accepted payload. Bigger frames close the connection.
+    const quint32 MAX_PAYLOAD_SIZE = 64 * 1024;
+}
+
+#endif // PROTOCOL_H
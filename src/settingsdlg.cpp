@@ -18,12 +18,14 @@
 #include "config.h"
 
 #include <QCheckBox>
+#include <QComboBox>
 #include <QFrame>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QLabel>
+#include <QPaintEvent>
 #include <QSpinBox>
 
 SettingsDlg::SettingsDlg(QWidget *parent)
@@ -33,6 +35,8 @@ SettingsDlg::SettingsDlg(QWidget *parent)
 , m_autoCopyCheck(new QCheckBox(this))
 , m_autoClearCheck(new QCheckBox(this))
 , m_alwaysOnTopCheck(new QCheckBox(this))
+, m_kdfCombo(new QComboBox(this))
+, m_background(":/back.png")
 {
     setWindowTitle(tr("Settings"));
 
@@ -62,6 +66,9 @@ void SettingsDlg::initWidgets()
     label4->setToolTip(tr("Automatically clear the clipboard on timeout."));
     QLabel * label5 = new QLabel(tr("Always on top:"));
     label5->setToolTip(tr("If set, the window remains always on top. Needs restarting to apply."));
+    QLabel * label6 = new QLabel(tr("Key derivation of new logins:"));
+    label6->setToolTip(tr("Saved logins keep the key derivation they were saved with. "
+        "Unsaved logins always use md5, the original derivation."));
 
     // Init master password delay spin box
     m_masterDelaySpinBox->setRange(1, 60);
@@ -71,6 +78,12 @@ void SettingsDlg::initWidgets()
     m_loginDelaySpinBox->setRange(1, 60);
     m_loginDelaySpinBox->setValue(5);
 
+    // Init key derivation combo box, the index is the algorithm
+    for (int i = 0; i < Kdf::ALGORITHM_COUNT; i++)
+    {
+        m_kdfCombo->addItem(Kdf::name(static_cast<Kdf::Algorithm>(i)));
+    }
+
     // Create and connect ok-button
     QPushButton * okButton = new QPushButton(tr("Ok"), this);
     connect(okButton, SIGNAL(clicked()), this, SLOT(accept()));
@@ -86,6 +99,8 @@ void SettingsDlg::initWidgets()
     layout->addWidget(m_autoClearCheck,     3, 1);
     layout->addWidget(label5,               4, 0);
     layout->addWidget(m_alwaysOnTopCheck,   4, 1);
+    layout->addWidget(label6,               5, 0);
+    layout->addWidget(m_kdfCombo,           5, 1);
 
     // Create the frame widget
     QFrame * frame = new QFrame(this);
@@ -104,25 +119,33 @@ void SettingsDlg::initWidgets()
 
 void SettingsDlg::initBackground()
 {
-    setStyleSheet("SettingsDlg { background-image: url(:/back.png) }");
+    // paintEvent() covers the whole dialog
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void SettingsDlg::paintEvent(QPaintEvent * event)
+{
+    m_background.paint(*this, event->rect());
 }
 
 void SettingsDlg::getSettings(int & rMasterDelay, int & rLoginDelay,
-    bool & rAutoCopy, bool & rAutoClear, bool & rAlwaysOnTop) const
+    bool & rAutoCopy, bool & rAutoClear, bool & rAlwaysOnTop, Kdf::Algorithm & rKdf) const
 {
    rMasterDelay = m_masterDelaySpinBox->value();
    rLoginDelay  = m_loginDelaySpinBox->value();
    rAutoCopy    = m_autoCopyCheck->isChecked();
    rAutoClear   = m_autoClearCheck->isChecked();
    rAlwaysOnTop = m_alwaysOnTopCheck->isChecked();
+   rKdf         = static_cast<Kdf::Algorithm>(m_kdfCombo->currentIndex());
 }
 
 void SettingsDlg::setSettings(int masterDelay, int loginDelay,
-    bool autoCopy, bool autoClear, bool alwaysOnTop)
+    bool autoCopy, bool autoClear, bool alwaysOnTop, Kdf::Algorithm kdf)
 {
    m_masterDelaySpinBox->setValue(masterDelay);
    m_loginDelaySpinBox->setValue(loginDelay);
    m_autoCopyCheck->setChecked(autoCopy);
    m_autoClearCheck->setChecked(autoClear);
    m_alwaysOnTopCheck->setChecked(alwaysOnTop);
+   m_kdfCombo->setCurrentIndex(kdf);
 }
@@ -19,7 +19,11 @@
 
 #include <QDialog>
 
+#include "backgroundrenderer.h"
+#include "kdf.h"
+
 class QCheckBox;
+class QComboBox;
 class QSpinBox;
 
 //! The settings dialog.
@@ -34,18 +38,23 @@ public:
 
     //! Store current settings to the given arguments.
     void getSettings(int & rMasterDelay, int & rloginDelay, bool & rAutoCopy,
-        bool & rAutoClear, bool & rAlwaysOnTop) const;
+        bool & rAutoClear, bool & rAlwaysOnTop, Kdf::Algorithm & rKdf) const;
 
     //! Take current settings from the given arguments.
     void setSettings(int masterDelay, int loginDelay, bool autoCopy,
-        bool autoClear, bool alwaysOnTop);
+        bool autoClear, bool alwaysOnTop, Kdf::Algorithm kdf);
+
+protected:
+
+    //! \reimp
+    virtual void paintEvent(QPaintEvent * event);
 
 private:
 
     //! Create and init the widgets.
     void initWidgets();
 
-    //! Set the background image.
+    //! Init the background painting.
     void initBackground();
 
     //! Spin box for the master password timeout.
@@ -63,6 +72,12 @@ private:
 
     //! Check box for window being always on top
     QCheckBox * m_alwaysOnTopCheck;
+
+    //! Combo box for the key derivation of new logins
+    QComboBox * m_kdfCombo;
+
+    //! Paints the background image.
+    BackgroundRenderer m_background;
 };
 
 #endif // SETTINGSDLG_H
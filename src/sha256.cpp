@@ -0,0 +1,267 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "sha256.h"
+
+#include <cstring>
+
+#define SHA256_ROTATE(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define SHA256_S0(x) (SHA256_ROTATE((x),  2) ^ SHA256_ROTATE((x), 13) ^ SHA256_ROTATE((x), 22))
+#define SHA256_S1(x) (SHA256_ROTATE((x),  6) ^ SHA256_ROTATE((x), 11) ^ SHA256_ROTATE((x), 25))
+#define SHA256_G0(x) (SHA256_ROTATE((x),  7) ^ SHA256_ROTATE((x), 18) ^ ((x) >>  3))
+#define SHA256_G1(x) (SHA256_ROTATE((x), 17) ^ SHA256_ROTATE((x), 19) ^ ((x) >> 10))
+
+#define SHA256_CH(x, y, z)  ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA256_MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+namespace
+{
+    const quint32 INITIAL_STATE[8] =
+    {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    const quint32 K[64] =
+    {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+    };
+
+    //! Read a big-endian word.
+    inline quint32 readWord(const quint8 * p)
+    {
+        return (static_cast<quint32>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    }
+
+    //! Write a big-endian word.
+    inline void writeWord(quint32 word, quint8 * p)
+    {
+        p[0] = static_cast<quint8>(word >> 24);
+        p[1] = static_cast<quint8>(word >> 16);
+        p[2] = static_cast<quint8>(word >> 8);
+        p[3] = static_cast<quint8>(word);
+    }
+
+    //! The SHA-256 compression function on a block of message words.
+    void compressWords(quint32 * state, quint32 * w)
+    {
+        for (int i = 16; i < 64; i++)
+        {
+            w[i] = SHA256_G1(w[i - 2]) + w[i - 7] + SHA256_G0(w[i - 15]) + w[i - 16];
+        }
+
+        quint32 a = state[0];
+        quint32 b = state[1];
+        quint32 c = state[2];
+        quint32 d = state[3];
+        quint32 e = state[4];
+        quint32 f = state[5];
+        quint32 g = state[6];
+        quint32 h = state[7];
+
+        for (int i = 0; i < 64; i++)
+        {
+            const quint32 t1 = h + SHA256_S1(e) + SHA256_CH(e, f, g) + K[i] + w[i];
+            const quint32 t2 = SHA256_S0(a) + SHA256_MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+    //! The SHA-256 compression function on a block of bytes.
+    void compress(quint32 * state, const quint8 * block)
+    {
+        quint32 w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = readWord(block + i * 4);
+        }
+
+        compressWords(state, w);
+    }
+
+    //! Hash a digest-sized message that follows a single block that
+    //! has already been hashed to state, as the inner and the outer
+    //! hashes of HMAC do. Stores the digest as words to rWords.
+    void compressDigest(const quint32 * state, const quint32 * digest, quint32 * rWords)
+    {
+        quint32 w[64];
+        std::memcpy(w, digest, Sha256::DIGEST_SIZE);
+
+        // Padding of a 32-byte message after a 64-byte block
+        w[8] = 0x80000000;
+        for (int i = 9; i < 15; i++)
+        {
+            w[i] = 0;
+        }
+        w[15] = (Sha256::BLOCK_SIZE + Sha256::DIGEST_SIZE) * 8;
+
+        std::memcpy(rWords, state, Sha256::DIGEST_SIZE);
+        compressWords(rWords, w);
+    }
+}
+
+void Sha256::hash(const char * data, int size, Digest & rDigest)
+{
+    Context context;
+    context.update(data, size);
+    context.finish(rDigest);
+}
+
+Sha256::Context::Context()
+: m_size(0)
+{
+    std::memcpy(m_state, INITIAL_STATE, sizeof(m_state));
+}
+
+void Sha256::Context::update(const char * data, int size)
+{
+    const quint8 * p = reinterpret_cast<const quint8 *>(data);
+
+    int used = m_size % BLOCK_SIZE;
+    m_size += size;
+
+    // Fill the incomplete block first
+    if (used)
+    {
+        const int n = qMin(size, BLOCK_SIZE - used);
+        std::memcpy(m_block + used, p, n);
+        p    += n;
+        size -= n;
+        used += n;
+
+        if (used < BLOCK_SIZE)
+        {
+            return;
+        }
+
+        compress(m_state, m_block);
+    }
+
+    for (; size >= BLOCK_SIZE; size -= BLOCK_SIZE, p += BLOCK_SIZE)
+    {
+        compress(m_state, p);
+    }
+
+    std::memcpy(m_block, p, size);
+}
+
+void Sha256::Context::finish(Digest & rDigest)
+{
+    const quint64 bits = m_size * 8;
+
+    quint8 padding[BLOCK_SIZE * 2] = {0x80};
+    const int used = m_size % BLOCK_SIZE;
+    const int size = (used < BLOCK_SIZE - 8 ? BLOCK_SIZE : BLOCK_SIZE * 2) - used;
+    writeWord(static_cast<quint32>(bits >> 32), padding + size - 8);
+    writeWord(static_cast<quint32>(bits), padding + size - 4);
+    update(reinterpret_cast<const char *>(padding), size);
+
+    for (int i = 0; i < 8; i++)
+    {
+        writeWord(m_state[i], rDigest + i * 4);
+    }
+}
+
+Sha256::Hmac::Hmac(const char * key, int size)
+{
+    // Keys longer than a block are hashed first
+    Digest keyDigest;
+    if (size > BLOCK_SIZE)
+    {
+        hash(key, size, keyDigest);
+        key  = reinterpret_cast<const char *>(keyDigest);
+        size = DIGEST_SIZE;
+    }
+
+    quint8 inner[BLOCK_SIZE];
+    quint8 outer[BLOCK_SIZE];
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        const quint8 k = i < size ? static_cast<quint8>(key[i]) : 0;
+        inner[i] = k ^ 0x36;
+        outer[i] = k ^ 0x5c;
+    }
+
+    m_inner.update(reinterpret_cast<const char *>(inner), BLOCK_SIZE);
+    m_outer.update(reinterpret_cast<const char *>(outer), BLOCK_SIZE);
+
+    // Don't leave the key lying around
+    std::memset(keyDigest, 0, sizeof(keyDigest));
+    std::memset(inner, 0, sizeof(inner));
+    std::memset(outer, 0, sizeof(outer));
+}
+
+Sha256::Hmac::~Hmac()
+{
+    std::memset(m_inner.m_state, 0, sizeof(m_inner.m_state));
+    std::memset(m_outer.m_state, 0, sizeof(m_outer.m_state));
+
+    // The blocks still hold the padded key
+    std::memset(m_inner.m_block, 0, sizeof(m_inner.m_block));
+    std::memset(m_outer.m_block, 0, sizeof(m_outer.m_block));
+}
+
+void Sha256::Hmac::mac(const char * data, int size, Digest & rDigest) const
+{
+    Context inner(m_inner);
+    inner.update(data, size);
+    inner.finish(rDigest);
+
+    Context outer(m_outer);
+    outer.update(reinterpret_cast<const char *>(rDigest), DIGEST_SIZE);
+    outer.finish(rDigest);
+}
+
+void Sha256::Hmac::macDigest(const Digest & in, Digest & rDigest) const
+{
+    quint32 words[8];
+    for (int i = 0; i < 8; i++)
+    {
+        words[i] = readWord(in + i * 4);
+    }
+
+    compressDigest(m_inner.m_state, words, words);
+    compressDigest(m_outer.m_state, words, words);
+
+    for (int i = 0; i < 8; i++)
+    {
+        writeWord(words[i], rDigest + i * 4);
+    }
+}
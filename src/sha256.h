@@ -0,0 +1,94 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <QtGlobal>
+
+//! SHA-256 (FIPS 180-4) and HMAC-SHA-256 (RFC 2104) for the key
+//! derivation functions.
+namespace Sha256
+{
+    //! Size of the digest in bytes.
+    const int DIGEST_SIZE = 32;
+
+    //! Size of a message block in bytes.
+    const int BLOCK_SIZE = 64;
+
+    //! Digest type.
+    typedef quint8 Digest[DIGEST_SIZE];
+
+    //! Hash a single message.
+    void hash(const char * data, int size, Digest & rDigest);
+
+    //! Incremental hash of a single message that is fed in pieces.
+    //! Works entirely on its own storage, so it can live on the stack.
+    class Context
+    {
+    public:
+
+        //! Constructor.
+        Context();
+
+        //! Append data to the message.
+        void update(const char * data, int size);
+
+        //! Finish the message and store its digest to rDigest.
+        void finish(Digest & rDigest);
+
+    private:
+
+        friend class Hmac;
+
+        //! Intermediate hash value.
+        quint32 m_state[8];
+
+        //! Bytes of the current, incomplete block.
+        quint8 m_block[BLOCK_SIZE];
+
+        //! Total size of the message so far.
+        quint64 m_size;
+    };
+
+    //! HMAC-SHA-256 with a fixed key. The padded key blocks are hashed
+    //! once, so a MAC costs only the blocks of the message.
+    class Hmac
+    {
+    public:
+
+        //! Constructor.
+        Hmac(const char * key, int size);
+
+        //! Destructor. Wipes the key states.
+        ~Hmac();
+
+        //! MAC of a message.
+        void mac(const char * data, int size, Digest & rDigest) const;
+
+        //! MAC of a message that is itself a digest, the inner loop of
+        //! PBKDF2. Costs two compressions. in and rDigest may be the same.
+        void macDigest(const Digest & in, Digest & rDigest) const;
+
+    private:
+
+        //! Hash states after the inner and the outer padded key.
+        Context m_inner;
+        Context m_outer;
+    };
+}
+
+#endif // SHA256_H
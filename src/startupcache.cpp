@@ -0,0 +1,182 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "startupcache.h"
+#include "loginio.h"
+#include "logintable.h"
+#include "urllistmodel.h"
+
+#include <QFile>
+#include <QScopedPointer>
+
+#include <cstring>
+
+namespace
+{
+    //! "FPMS" in the byte order of the machine.
+    const quint32 MAGIC = 0x534d5046;
+
+    //! 64-bit FNV-1a over whole words, fast enough to check the image on
+    //! every start. Only meant to catch torn and damaged files.
+    quint64 checksum(const char * data, int size)
+    {
+        quint64 hash = Q_UINT64_C(14695981039346656037);
+        int i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            quint64 word;
+            std::memcpy(&word, data + i, 8);
+            hash = (hash ^ word) * Q_UINT64_C(1099511628211);
+        }
+
+        for (; i < size; i++)
+        {
+            hash = (hash ^ static_cast<uchar>(data[i])) * Q_UINT64_C(1099511628211);
+        }
+
+        return hash;
+    }
+
+    void append32(QByteArray & rOut, quint32 value)
+    {
+        rOut.append(reinterpret_cast<const char *>(&value), 4);
+    }
+
+    quint32 read32(const char * data)
+    {
+        quint32 value;
+        std::memcpy(&value, data, 4);
+        return value;
+    }
+}
+
+StartupCache::StartupCache(const QString & fileName)
+: m_fileName(fileName)
+{}
+
+const QString & StartupCache::fileName() const
+{
+    return m_fileName;
+}
+
+bool StartupCache::read(const QByteArray & state, LoginTable & rLogins,
+    QVector<QString> & rSortedUrls) const
+{
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const QByteArray image = file.readAll();
+    const char     * data  = image.constData();
+    if (image.size() < HEADER_SIZE ||
+        state.size() > image.size() - HEADER_SIZE ||
+        read32(data) != MAGIC ||
+        read32(data + 4) != VERSION ||
+        read32(data + 8) != static_cast<quint32>(state.size()) ||
+        read32(data + 12) != static_cast<quint32>(image.size() - HEADER_SIZE - state.size()))
+    {
+        return false;
+    }
+
+    quint64 sum;
+    std::memcpy(&sum, data + 16, 8);
+    if (sum != checksum(data + HEADER_SIZE, image.size() - HEADER_SIZE) ||
+        std::memcmp(data + HEADER_SIZE, state.constData(), state.size()) != 0)
+    {
+        return false;
+    }
+
+    int pos = HEADER_SIZE + state.size();
+    LoginTable logins;
+    if (!logins.readImage(data, image.size(), pos) || image.size() - pos < 4)
+    {
+        return false;
+    }
+
+    const quint32 count = read32(data + pos);
+    pos += 4;
+    if (count != static_cast<quint32>(logins.count()) ||
+        static_cast<qint64>(count) * 4 != image.size() - pos)
+    {
+        return false;
+    }
+
+    QVector<QString> urls;
+    urls.reserve(count);
+    for (quint32 i = 0; i < count; i++, pos += 4)
+    {
+        const quint32 row = read32(data + pos);
+        if (row >= count)
+        {
+            return false;
+        }
+
+        urls << logins.at(row).url();
+    }
+
+    rLogins     = logins;
+    rSortedUrls = urls;
+    return true;
+}
+
+bool StartupCache::write(const QByteArray & state, const LoginTable & logins,
+    const UrlListModel & urls) const
+{
+    QByteArray image(HEADER_SIZE, '\0');
+    image += state;
+
+    logins.writeImage(image);
+    append32(image, urls.rowCount());
+    for (int i = 0; i < urls.rowCount(); i++)
+    {
+        const int row = logins.find(urls.url(i));
+        if (row < 0)
+        {
+            return false;
+        }
+
+        append32(image, row);
+    }
+
+    char * data = image.data();
+    const quint32 header[4] =
+    {
+        MAGIC, VERSION, static_cast<quint32>(state.size()),
+        static_cast<quint32>(image.size() - HEADER_SIZE - state.size())
+    };
+    std::memcpy(data, header, sizeof(header));
+
+    const quint64 sum = checksum(data + HEADER_SIZE, image.size() - HEADER_SIZE);
+    std::memcpy(data + 16, &sum, 8);
+
+    // Replace the old image only once the new one is on disk
+    QScopedPointer<QIODevice> file(LoginIO::openSaveFile(m_fileName, QIODevice::NotOpen));
+    if (file.isNull())
+    {
+        return false;
+    }
+
+    if (file->write(image) != image.size() ||
+        !LoginIO::commitSaveFile(file.data(), m_fileName))
+    {
+        LoginIO::discardSaveFile(file.data(), m_fileName);
+        return false;
+    }
+
+    return true;
+}
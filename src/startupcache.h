@@ -0,0 +1,71 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef STARTUPCACHE_H
+#define STARTUPCACHE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class LoginTable;
+class UrlListModel;
+
+//! Image of the saved logins written after they change and at exit, so
+//! that the next start restores the login table and the sorted urls of
+//! the combo box with a single read instead of loading the login store
+//! and sorting the urls.
+//!
+//! The image is tied to the LoginStore::state() it was written for and
+//! is ignored once the store has changed. It's in the byte order of the
+//! machine, which the magic number catches.
+//!
+//! Header (HEADER_SIZE bytes, quint32s):
+//!   magic "FPMS", version, size of the state, size of the body,
+//!   checksum of the state and the body (two quint32s).
+//!
+//! Followed by the state and the body: a LoginTable image, the number
+//! of urls and the row of every url in the order of UrlListModel.
+class StartupCache
+{
+public:
+
+    //! Version of the format written by this version. Caches of
+    //! other versions are ignored, which costs one full load.
+    static const quint32 VERSION = 2;
+
+    //! Size of the header.
+    static const int HEADER_SIZE = 24;
+
+    //! Constructor.
+    explicit StartupCache(const QString & fileName);
+
+    //! Name of the cache file.
+    const QString & fileName() const;
+
+    //! Read the logins and the sorted urls if the cache was written for
+    //! the given state of the store. Leaves the outputs untouched on failure.
+    bool read(const QByteArray & state, LoginTable & rLogins, QVector<QString> & rSortedUrls) const;
+
+    //! Write the logins and the order of the urls for the given state of the store.
+    bool write(const QByteArray & state, const LoginTable & logins, const UrlListModel & urls) const;
+
+private:
+
+    QString m_fileName;
+};
+
+#endif // STARTUPCACHE_H
@@ -0,0 +1,155 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "storeworker.h"
+#include "loginstore.h"
+#include "trace.h"
+
+#include <QMutexLocker>
+#include <QStringList>
+
+namespace
+{
+    //! Time in ms a burst of changes may take to arrive before they're written.
+    const unsigned long COALESCE_DELAY = 20;
+}
+
+StoreWorker::StoreWorker(LoginStore & store)
+: m_store(store)
+, m_busy(false)
+, m_flushing(0)
+, m_stopping(false)
+, m_ok(true)
+{
+    start(QThread::LowPriority);
+}
+
+void StoreWorker::save(const LoginData & login)
+{
+    QMutexLocker locker(&m_mutex);
+    queue(login, false);
+}
+
+void StoreWorker::save(const LoginIO::LoginList & logins)
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < logins.count(); i++)
+    {
+        queue(logins.at(i), false);
+    }
+}
+
+void StoreWorker::remove(const QString & url)
+{
+    QMutexLocker locker(&m_mutex);
+    queue(LoginData(url, "", 0), true);
+}
+
+void StoreWorker::queue(const LoginData & login, bool remove)
+{
+    // Only the first change of a burst wakes the thread so that
+    // it can wait for the rest
+    if (m_pending.isEmpty())
+    {
+        m_changed.wakeOne();
+    }
+
+    Change & change = m_pending[login.url()];
+    change.login  = login;
+    change.remove = remove;
+}
+
+bool StoreWorker::flush()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_flushing++;
+    m_changed.wakeOne();
+    while (!m_pending.isEmpty() || m_busy)
+    {
+        m_written.wait(&m_mutex);
+    }
+
+    m_flushing--;
+
+    const bool ok = m_ok;
+    m_ok = true;
+    return ok;
+}
+
+void StoreWorker::run()
+{
+    QMutexLocker locker(&m_mutex);
+    for (;;)
+    {
+        while (m_pending.isEmpty() && !m_stopping)
+        {
+            m_changed.wait(&m_mutex);
+        }
+
+        if (m_pending.isEmpty())
+        {
+            break;
+        }
+
+        // Let the rest of a burst arrive unless somebody is waiting
+        if (!m_stopping && !m_flushing)
+        {
+            m_changed.wait(&m_mutex, COALESCE_DELAY);
+        }
+
+        LoginIO::LoginList saved;
+        QStringList        removed;
+        for (QHash<QString, Change>::const_iterator i = m_pending.constBegin();
+            i != m_pending.constEnd(); i++)
+        {
+            if (i.value().remove)
+            {
+                removed << i.key();
+            }
+            else
+            {
+                saved << i.value().login;
+            }
+        }
+
+        m_pending.clear();
+        m_busy = true;
+
+        locker.unlock();
+        bool ok = false;
+        {
+            TRACE_SPAN("StoreWorker::write");
+            ok = m_store.update(saved, removed);
+        }
+        locker.relock();
+
+        m_busy = false;
+        m_ok   = m_ok && ok;
+        m_written.wakeAll();
+    }
+}
+
+StoreWorker::~StoreWorker()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_changed.wakeOne();
+    }
+
+    wait();
+}
@@ -0,0 +1,101 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef STOREWORKER_H
+#define STOREWORKER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "loginio.h"
+
+class LoginStore;
+
+//! Writes changes to a LoginStore in a background thread so that saving
+//! never blocks the caller. Changes queued while a write is in progress,
+//! or within a short delay of each other, are written together, and only
+//! the last change of each url is kept.
+class StoreWorker : public QThread
+{
+public:
+
+    //! Constructor. Starts the thread. The store must be loaded and
+    //! must not be used by others until flush() returns.
+    explicit StoreWorker(LoginStore & store);
+
+    //! Destructor. Writes the queued changes and stops the thread.
+    ~StoreWorker();
+
+    //! Queue saving a login.
+    void save(const LoginData & login);
+
+    //! Queue saving several logins.
+    void save(const LoginIO::LoginList & logins);
+
+    //! Queue removing the login of the url.
+    void remove(const QString & url);
+
+    //! Wait until all queued changes are written. Return false if a
+    //! write has failed since the previous flush().
+    bool flush();
+
+protected:
+
+    //! \reimp
+    virtual void run();
+
+private:
+
+    //! A queued change.
+    struct Change
+    {
+        LoginData login;
+        bool      remove;
+    };
+
+    //! Queue a change. The mutex must be locked.
+    void queue(const LoginData & login, bool remove);
+
+    LoginStore & m_store;
+
+    //! Protects the members below.
+    QMutex m_mutex;
+
+    //! Signaled when there are changes or the thread should stop.
+    QWaitCondition m_changed;
+
+    //! Signaled after a write.
+    QWaitCondition m_written;
+
+    //! Queued changes by url.
+    QHash<QString, Change> m_pending;
+
+    //! True while the thread is writing.
+    bool m_busy;
+
+    //! Number of threads waiting in flush().
+    int m_flushing;
+
+    //! True when the thread should stop.
+    bool m_stopping;
+
+    //! False if a write has failed.
+    bool m_ok;
+};
+
+#endif // STOREWORKER_H
@@ -0,0 +1,143 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "trace.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+namespace Trace
+{
+    bool g_enabled = false;
+}
+
+namespace
+{
+    //! Spans kept at most, so that a long session doesn't grow without
+    //! bounds. The later spans are dropped.
+    const int MAX_EVENTS = 1 << 20;
+
+    //! A finished span.
+    struct Event
+    {
+        const char * name;
+        qint64       start;
+        qint64       end;
+        quintptr     thread;
+    };
+
+    QString         g_fileName;
+    QElapsedTimer   g_clock;
+    QMutex          g_mutex;
+    QVector<Event>  g_events;
+
+    //! Append the nanoseconds as microseconds, the unit of the format.
+    void appendMicros(QByteArray & rOut, qint64 ns)
+    {
+        rOut += QByteArray::number(ns / 1000);
+        rOut += '.';
+        rOut += QByteArray::number(ns % 1000 + 1000).mid(1);
+    }
+
+    void appendString(QByteArray & rOut, const char * value)
+    {
+        rOut += '"';
+        for (; *value; value++)
+        {
+            if (*value == '"' || *value == '\\')
+            {
+                rOut += '\\';
+            }
+
+            rOut += *value;
+        }
+
+        rOut += '"';
+    }
+}
+
+void Trace::start(const QString & fileName)
+{
+    g_fileName = fileName;
+    g_events.clear();
+    g_events.reserve(1024);
+    g_clock.start();
+    g_enabled = true;
+}
+
+bool Trace::finish()
+{
+    if (!g_enabled)
+    {
+        return true;
+    }
+
+    g_enabled = false;
+
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    // Complete events ("ph": "X") of one process, a track per thread
+    QByteArray json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    QMutexLocker locker(&g_mutex);
+    for (int i = 0; i < g_events.count(); i++)
+    {
+        const Event & event = g_events.at(i);
+
+        json += i ? ",\n" : "\n";
+        json += "{\"name\":";
+        appendString(json, event.name);
+        json += ",\"cat\":\"fleetingpm\",\"ph\":\"X\",\"ts\":";
+        appendMicros(json, event.start);
+        json += ",\"dur\":";
+        appendMicros(json, event.end - event.start);
+        json += ",\"pid\":" + pid;
+        json += ",\"tid\":" + QByteArray::number(static_cast<qulonglong>(event.thread));
+        json += '}';
+    }
+
+    json += "\n]}\n";
+    g_events.clear();
+
+    QFile file(g_fileName);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) &&
+        file.write(json) == json.size();
+}
+
+qint64 Trace::now()
+{
+    return g_clock.nsecsElapsed();
+}
+
+void Trace::record(const char * name, qint64 start)
+{
+    Event event;
+    event.name   = name;
+    event.start  = start;
+    event.end    = now();
+    event.thread = reinterpret_cast<quintptr>(QThread::currentThreadId());
+
+    QMutexLocker locker(&g_mutex);
+    if (g_events.count() < MAX_EVENTS)
+    {
+        g_events << event;
+    }
+}
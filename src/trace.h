@@ -0,0 +1,88 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+
+//! Records nested spans of time and writes them as a Chrome trace_event
+//! JSON file that trace viewers like chrome://tracing and Perfetto open.
+//!
+//! Recording is off unless start() is called. A disabled span costs the
+//! test of a flag, so the spans can stay in the hot paths. Span names
+//! must be string literals, since only the pointers are recorded.
+namespace Trace
+{
+    //! Start recording. The spans are written to fileName by finish().
+    void start(const QString & fileName);
+
+    //! Write the recorded spans and stop recording. Return false if the
+    //! file couldn't be written. Does nothing if not recording.
+    bool finish();
+
+    //! True while recording. Use isEnabled().
+    extern bool g_enabled;
+
+    //! Return true if recording. Set before any threads are started.
+    inline bool isEnabled()
+    {
+        return g_enabled;
+    }
+
+    //! Nanoseconds since start().
+    qint64 now();
+
+    //! Record a span from start to now on the calling thread.
+    void record(const char * name, qint64 start);
+
+    //! Records the time from its construction to its destruction.
+    class Span
+    {
+    public:
+
+        explicit Span(const char * name)
+        : m_name(name)
+        , m_start(isEnabled() ? now() : -1)
+        {}
+
+        ~Span()
+        {
+            if (m_start >= 0)
+            {
+                record(m_name, m_start);
+            }
+        }
+
+    private:
+
+        Span(const Span &);
+        Span & operator=(const Span &);
+
+        const char * m_name;
+
+        qint64 m_start;
+    };
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+//! Trace the rest of the enclosing scope as a span of the given name.
+#define TRACE_SPAN(name) Trace::Span TRACE_CONCAT(traceSpan, __LINE__)(name)
+
+#endif // TRACE_H
@@ -0,0 +1,54 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef URLCOMPLETER_H
+#define URLCOMPLETER_H
+
+#include <QCompleter>
+
+class QStringListModel;
+class UrlListModel;
+
+//! Completes urls as they are typed. Instead of letting QCompleter
+//! filter all saved urls, the first MAX_COMPLETIONS matches of the
+//! typed prefix are taken from the sorted UrlListModel. Connect
+//! updateCompletions() to the textEdited() signal of the line edit.
+class UrlCompleter : public QCompleter
+{
+    Q_OBJECT
+
+public:
+
+    //! Number of completions shown at most.
+    static const int MAX_COMPLETIONS = 10;
+
+    //! Constructor.
+    UrlCompleter(const UrlListModel & urls, QObject * parent = 0);
+
+public slots:
+
+    //! Refill the completions with the urls matching prefix.
+    void updateCompletions(const QString & prefix);
+
+private:
+
+    const UrlListModel & m_urls;
+
+    //! Completions of the current prefix.
+    QStringListModel * m_completions;
+};
+
+#endif // URLCOMPLETER_H
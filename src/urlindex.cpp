@@ -0,0 +1,151 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "urlindex.h"
+
+namespace
+{
+    //! Smallest number of slots.
+    const int MIN_CAPACITY = 16;
+}
+
+UrlIndex::UrlIndex()
+: m_capacity(0)
+, m_count(0)
+, m_removed(0)
+, m_filterShift(0)
+{
+    rebuild(QVector<quint32>(), 0);
+}
+
+int UrlIndex::count() const
+{
+    return m_count;
+}
+
+bool UrlIndex::isFull() const
+{
+    // Keep at least 1/8 of the slots empty so that the probes stay short
+    return (m_count + m_removed + 1) * 8 > m_capacity * 7;
+}
+
+void UrlIndex::rebuild(const QVector<quint32> & hashes, int capacity)
+{
+    capacity = qMax(capacity, hashes.count());
+
+    m_capacity = MIN_CAPACITY;
+    while (capacity * 8 > m_capacity * 7)
+    {
+        m_capacity *= 2;
+    }
+
+    m_count   = 0;
+    m_removed = 0;
+    m_ctrl.fill(EMPTY, m_capacity + GROUP_SIZE);
+    m_rows.fill(0, m_capacity);
+
+    // One filter byte per slot
+    const int words = m_capacity / 8;
+    m_filter.fill(0, words);
+    m_filterShift = 32;
+    for (int i = words; i > 1; i /= 2)
+    {
+        m_filterShift--;
+    }
+
+    for (int row = 0; row < hashes.count(); row++)
+    {
+        insert(hashes.at(row), row);
+    }
+}
+
+void UrlIndex::insert(quint32 hash, quint32 row)
+{
+    const int mask = m_capacity - 1;
+    int pos = hash & mask;
+    for (int step = GROUP_SIZE; ; step += GROUP_SIZE)
+    {
+        const quint32 free = matchFree(m_ctrl.constData() + pos);
+        if (free)
+        {
+            const int slot = (pos + lowestBit(free)) & mask;
+            if (m_ctrl.at(slot) == REMOVED)
+            {
+                m_removed--;
+            }
+
+            setCtrl(slot, tag(hash));
+            m_rows[slot] = row;
+            break;
+        }
+
+        pos = (pos + step) & mask;
+    }
+
+    m_filter[filterWord(hash)] |= filterBits(hash);
+    m_count++;
+}
+
+void UrlIndex::remove(quint32 hash, quint32 row)
+{
+    // The filter keeps the bits of the row until the next rebuild
+    setCtrl(slotOf(hash, row), REMOVED);
+    m_count--;
+    m_removed++;
+}
+
+void UrlIndex::move(quint32 hash, quint32 from, quint32 to)
+{
+    m_rows[slotOf(hash, from)] = to;
+}
+
+qint64 UrlIndex::memoryUsage() const
+{
+    return m_ctrl.capacity() * sizeof(quint8) +
+        static_cast<qint64>(m_rows.capacity()) * sizeof(quint32) +
+        static_cast<qint64>(m_filter.capacity()) * sizeof(quint64);
+}
+
+void UrlIndex::setCtrl(int slot, quint8 value)
+{
+    m_ctrl[slot] = value;
+    if (slot < GROUP_SIZE)
+    {
+        m_ctrl[m_capacity + slot] = value;
+    }
+}
+
+int UrlIndex::slotOf(quint32 hash, quint32 row) const
+{
+    const quint8 * ctrl = m_ctrl.constData();
+    const quint8   wanted = tag(hash);
+    const int      mask = m_capacity - 1;
+
+    int pos = hash & mask;
+    for (int step = GROUP_SIZE; ; step += GROUP_SIZE)
+    {
+        for (quint32 matches = match(ctrl + pos, wanted); matches; matches &= matches - 1)
+        {
+            const int slot = (pos + lowestBit(matches)) & mask;
+            if (m_rows.at(slot) == row)
+            {
+                return slot;
+            }
+        }
+
+        pos = (pos + step) & mask;
+    }
+}
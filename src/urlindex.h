@@ -0,0 +1,231 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef URLINDEX_H
+#define URLINDEX_H
+
+#include <QVector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+//! Flat open addressing index from url hashes to the rows of LoginTable.
+//!
+//! The slots are probed a group of GROUP_SIZE at a time: every slot has a
+//! control byte holding 7 bits of the hash, and a whole group of them is
+//! compared to the wanted bits at once, with SSE2 where available. Only
+//! the rows whose bits match are compared by the caller. A small Bloom
+//! filter in front of the slots answers most lookups of missing urls
+//! with a single memory access.
+//!
+//! The index doesn't own the keys or their hashes. The table passes the
+//! hashes of all rows to rebuild() when the index gets full.
+class UrlIndex
+{
+public:
+
+    //! Number of control bytes compared at a time.
+    static const int GROUP_SIZE = 16;
+
+    //! Constructor.
+    UrlIndex();
+
+    //! Number of rows in the index.
+    int count() const;
+
+    //! Return true if rebuild() must be called before inserting a row.
+    bool isFull() const;
+
+    //! Rebuild the index for the rows of the given hashes with room
+    //! for at least capacity rows. Drops the removed slots.
+    void rebuild(const QVector<quint32> & hashes, int capacity);
+
+    //! Return false if no row has the hash. May return true for a
+    //! missing hash.
+    bool mayContain(quint32 hash) const;
+
+    //! Return the row with the hash for which equal(row) is true, or -1.
+    template <typename Equal>
+    int find(quint32 hash, Equal equal) const;
+
+    //! Add a row that isn't in the index. The index must not be full.
+    void insert(quint32 hash, quint32 row);
+
+    //! Remove a row.
+    void remove(quint32 hash, quint32 row);
+
+    //! Change the row number of a row.
+    void move(quint32 hash, quint32 from, quint32 to);
+
+    //! Bytes allocated by the index.
+    qint64 memoryUsage() const;
+
+private:
+
+    //! Control bytes of the free slots. Those of the used slots
+    //! are the 7 high bits of the hash.
+    enum Ctrl
+    {
+        EMPTY   = 0x80,
+        REMOVED = 0xfe
+    };
+
+    //! Bit mask of the slots of the group at ctrl whose control byte is
+    //! value. Bit i stands for slot i of the group.
+    static quint32 match(const quint8 * ctrl, quint8 value);
+
+    //! Bit mask of the empty and removed slots of the group at ctrl.
+    static quint32 matchFree(const quint8 * ctrl);
+
+    //! Index of the lowest set bit of a non-zero mask.
+    static int lowestBit(quint32 mask);
+
+    //! Control byte of a row with the hash.
+    static quint8 tag(quint32 hash);
+
+    //! Set the control byte of a slot and its mirror.
+    void setCtrl(int slot, quint8 value);
+
+    //! Return the slot of the row with the hash.
+    int slotOf(quint32 hash, quint32 row) const;
+
+    //! Filter word and bits of the hash.
+    int filterWord(quint32 hash) const;
+    static quint64 filterBits(quint32 hash);
+
+    //! Number of slots, a power of two.
+    int m_capacity;
+
+    int m_count;
+
+    //! Removed slots, which still lengthen the probes.
+    int m_removed;
+
+    //! Control bytes of the slots. The first group is repeated at
+    //! the end so that a group can be loaded from any slot.
+    QVector<quint8> m_ctrl;
+
+    //! Rows of the slots.
+    QVector<quint32> m_rows;
+
+    //! Bloom filter of the hashes, two bits per row in one word.
+    QVector<quint64> m_filter;
+
+    //! log2 of the number of filter words.
+    int m_filterShift;
+};
+
+inline quint32 UrlIndex::match(const quint8 * ctrl, quint8 value)
+{
+#ifdef __SSE2__
+    const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(value))));
+#else
+    quint32 mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+    {
+        mask |= static_cast<quint32>(ctrl[i] == value) << i;
+    }
+
+    return mask;
+#endif
+}
+
+inline quint32 UrlIndex::matchFree(const quint8 * ctrl)
+{
+    // The free control bytes are the ones with the high bit set
+#ifdef __SSE2__
+    return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)));
+#else
+    quint32 mask = 0;
+    for (int i = 0; i < GROUP_SIZE; i++)
+    {
+        mask |= static_cast<quint32>(ctrl[i] >> 7) << i;
+    }
+
+    return mask;
+#endif
+}
+
+inline int UrlIndex::lowestBit(quint32 mask)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1))
+    {
+        mask >>= 1;
+        bit++;
+    }
+
+    return bit;
+#endif
+}
+
+inline quint8 UrlIndex::tag(quint32 hash)
+{
+    return hash >> 25;
+}
+
+inline int UrlIndex::filterWord(quint32 hash) const
+{
+    return (hash * 0x9e3779b1u) >> m_filterShift;
+}
+
+inline quint64 UrlIndex::filterBits(quint32 hash)
+{
+    const quint32 bits = hash * 0x85ebca77u;
+    return (Q_UINT64_C(1) << (bits >> 26)) | (Q_UINT64_C(1) << ((bits >> 20) & 63));
+}
+
+inline bool UrlIndex::mayContain(quint32 hash) const
+{
+    const quint64 bits = filterBits(hash);
+    return (m_filter.at(filterWord(hash)) & bits) == bits;
+}
+
+template <typename Equal>
+int UrlIndex::find(quint32 hash, Equal equal) const
+{
+    const quint8 * ctrl = m_ctrl.constData();
+    const quint8   wanted = tag(hash);
+    const int      mask = m_capacity - 1;
+
+    // Triangular steps of whole groups visit every group once
+    int pos = hash & mask;
+    for (int step = GROUP_SIZE; ; step += GROUP_SIZE)
+    {
+        for (quint32 matches = match(ctrl + pos, wanted); matches; matches &= matches - 1)
+        {
+            const int slot = (pos + lowestBit(matches)) & mask;
+            if (equal(m_rows.at(slot)))
+            {
+                return m_rows.at(slot);
+            }
+        }
+
+        if (match(ctrl + pos, EMPTY))
+        {
+            return -1;
+        }
+
+        pos = (pos + step) & mask;
+    }
+}
+
+#endif // URLINDEX_H
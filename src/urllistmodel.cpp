@@ -0,0 +1,162 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "urllistmodel.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+    bool equalUrls(const QString & a, const QString & b)
+    {
+        return a == b;
+    }
+
+    //! The case-insensitive part of the order of the model.
+    bool lessThanIgnoringCase(const QString & a, const QString & b)
+    {
+        return QString::compare(a, b, Qt::CaseInsensitive) < 0;
+    }
+
+    //! Sort the urls to the order of the model and remove duplicates.
+    QVector<QString> sorted(const QStringList & urls)
+    {
+        QVector<QString> result = urls.toVector();
+        std::sort(result.begin(), result.end(), UrlListModel::lessThan);
+        result.erase(std::unique(result.begin(), result.end(), equalUrls), result.end());
+        return result;
+    }
+}
+
+UrlListModel::UrlListModel(QObject * parent)
+: QAbstractListModel(parent)
+{}
+
+int UrlListModel::rowCount(const QModelIndex & parent) const
+{
+    return parent.isValid() ? 0 : m_urls.count();
+}
+
+QVariant UrlListModel::data(const QModelIndex & index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_urls.count() ||
+        (role != Qt::DisplayRole && role != Qt::EditRole))
+    {
+        return QVariant();
+    }
+
+    return m_urls.at(index.row());
+}
+
+void UrlListModel::setUrls(const QStringList & urls)
+{
+    beginResetModel();
+    m_urls = sorted(urls);
+    endResetModel();
+}
+
+void UrlListModel::setSortedUrls(const QVector<QString> & urls)
+{
+    beginResetModel();
+    m_urls = urls;
+    endResetModel();
+}
+
+void UrlListModel::addUrls(const QStringList & urls)
+{
+    if (urls.isEmpty())
+    {
+        return;
+    }
+
+    const QVector<QString> added = sorted(urls);
+
+    QVector<QString> merged;
+    merged.reserve(m_urls.count() + added.count());
+    std::set_union(m_urls.constBegin(), m_urls.constEnd(),
+        added.constBegin(), added.constEnd(), std::back_inserter(merged), lessThan);
+
+    beginResetModel();
+    m_urls = merged;
+    endResetModel();
+}
+
+int UrlListModel::add(const QString & url)
+{
+    const int row = lowerBound(url);
+    if (row < m_urls.count() && m_urls.at(row) == url)
+    {
+        return row;
+    }
+
+    beginInsertRows(QModelIndex(), row, row);
+    m_urls.insert(row, url);
+    endInsertRows();
+    return row;
+}
+
+bool UrlListModel::remove(const QString & url)
+{
+    const int row = find(url);
+    if (row < 0)
+    {
+        return false;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    m_urls.remove(row);
+    endRemoveRows();
+    return true;
+}
+
+int UrlListModel::find(const QString & url) const
+{
+    const int row = lowerBound(url);
+    return row < m_urls.count() && m_urls.at(row) == url ? row : -1;
+}
+
+const QString & UrlListModel::url(int row) const
+{
+    return m_urls.at(row);
+}
+
+QStringList UrlListModel::completions(const QString & prefix, int count) const
+{
+    QVector<QString>::const_iterator url = std::lower_bound(m_urls.constBegin(),
+        m_urls.constEnd(), prefix, lessThanIgnoringCase);
+
+    QStringList result;
+    while (url != m_urls.constEnd() && result.count() < count &&
+        url->startsWith(prefix, Qt::CaseInsensitive))
+    {
+        result << *url++;
+    }
+
+    return result;
+}
+
+bool UrlListModel::lessThan(const QString & a, const QString & b)
+{
+    const int result = QString::compare(a, b, Qt::CaseInsensitive);
+    return result ? result < 0 : a < b;
+}
+
+int UrlListModel::lowerBound(const QString & url) const
+{
+    return std::lower_bound(m_urls.constBegin(), m_urls.constEnd(), url, lessThan) -
+        m_urls.constBegin();
+}
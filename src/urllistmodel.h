@@ -0,0 +1,78 @@
+// This file is part of Fleeting Password Manager (Fleetingpm).
+// Copyright (C) 2011 Jussi Lind <jussi.lind@iki.fi>
+//
+// Fleetingpm is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// Fleetingpm is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Fleetingpm. If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef URLLISTMODEL_H
+#define URLLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QStringList>
+#include <QVector>
+
+//! Sorted list of the saved urls for the url combo box. The urls are
+//! ordered case-insensitively, ties broken case-sensitively, and found
+//! with a binary search.
+class UrlListModel : public QAbstractListModel
+{
+public:
+
+    //! Constructor.
+    explicit UrlListModel(QObject * parent = 0);
+
+    //! \reimp
+    virtual int rowCount(const QModelIndex & parent = QModelIndex()) const;
+
+    //! \reimp
+    virtual QVariant data(const QModelIndex & index, int role = Qt::DisplayRole) const;
+
+    //! Replace all urls. The list needn't be sorted or unique.
+    void setUrls(const QStringList & urls);
+
+    //! Replace all urls with urls already sorted and unique, like
+    //! those of an earlier model.
+    void setSortedUrls(const QVector<QString> & urls);
+
+    //! Add urls that are not in the model yet with one merge.
+    void addUrls(const QStringList & urls);
+
+    //! Add the url if it's not in the model yet. Return its row.
+    int add(const QString & url);
+
+    //! Remove the url. Return false if it's not in the model.
+    bool remove(const QString & url);
+
+    //! Return the row of the url or -1 if there isn't one.
+    int find(const QString & url) const;
+
+    //! Return the url of the row.
+    const QString & url(int row) const;
+
+    //! Return at most count urls that start with the prefix ignoring
+    //! case, in the order of the model. The matches of a prefix are
+    //! adjacent in the model, so this is a binary search and a copy.
+    QStringList completions(const QString & prefix, int count) const;
+
+    //! The sort order of the model.
+    static bool lessThan(const QString & a, const QString & b);
+
+private:
+
+    //! Return the row of the first url that is not less than the given one.
+    int lowerBound(const QString & url) const;
+
+    QVector<QString> m_urls;
+};
+
+#endif // URLLISTMODEL_H